@@ -0,0 +1,219 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// replays control cycles recorded with the record_file parameter of the planner, as fast
+// as possible and without ROS master, reports timing and differences to recorded commands
+//
+// usage: replay_cycles <bag file> [scoring threads] [velocity tolerance]
+
+#define VELOCITY_TOLERANCE 1e-6 // m/s or rad/s, larger differences to recorded commands are reported
+#define MAX_LISTED_DIFFERENCES 10 // differing cycles listed individually
+
+#include <hanp_local_planner/hanp_local_planner.h>
+#include <hanp_local_planner/cycle_recorder.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    // the costmap is replaced as a whole, reallocated only when its geometry changes
+    void copyCostmap(const nav_msgs::OccupancyGrid& grid, costmap_2d::Costmap2D& costmap)
+    {
+        // resolution is recorded as float, but set as a short decimal in costmap parameters
+        char resolution_string[32];
+        snprintf(resolution_string, sizeof(resolution_string), "%.7g", grid.info.resolution);
+        double resolution = strtod(resolution_string, NULL);
+
+        if(costmap.getSizeInCellsX() != grid.info.width || costmap.getSizeInCellsY() != grid.info.height ||
+            costmap.getResolution() != resolution ||
+            costmap.getOriginX() != grid.info.origin.position.x ||
+            costmap.getOriginY() != grid.info.origin.position.y)
+        {
+            costmap.resizeMap(grid.info.width, grid.info.height, resolution,
+                grid.info.origin.position.x, grid.info.origin.position.y);
+        }
+        std::memcpy(costmap.getCharMap(), grid.data.data(), grid.data.size());
+    }
+
+    void footprintFromMsg(const geometry_msgs::Polygon& polygon, std::vector<geometry_msgs::Point>& footprint)
+    {
+        footprint.resize(polygon.points.size());
+        for(unsigned int i = 0; i < polygon.points.size(); ++i)
+        {
+            footprint[i].x = polygon.points[i].x;
+            footprint[i].y = polygon.points[i].y;
+            footprint[i].z = polygon.points[i].z;
+        }
+    }
+
+    void printStage(hanp_local_planner::LatencyStats& stats, hanp_local_planner::LatencyStats::Stage stage)
+    {
+        auto summary = stats.collect(stage, false);
+        printf("  %-16s %8lu %10.3f %10.3f %10.3f %10.3f\n", hanp_local_planner::LatencyStats::stageName(stage),
+            (unsigned long)summary.count, summary.p50 / 1e6, summary.p99 / 1e6, summary.max / 1e6,
+            summary.mean / 1e6);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "usage: %s <bag file> [scoring threads] [velocity tolerance]\n", argv[0]);
+        return 1;
+    }
+    int scoring_threads = argc > 2 ? atoi(argv[2]) : (int)boost::thread::hardware_concurrency();
+    double tolerance = argc > 3 ? atof(argv[3]) : VELOCITY_TOLERANCE;
+
+    // wall time, without ros::init nothing tries to reach the ROS master
+    ros::Time::init();
+
+    // all cycles are decoded up front, only planning is timed
+    std::vector<hanp_local_planner::RecordedCycle> cycles;
+    hanp_local_planner::CycleReader reader;
+    if(!reader.open(argv[1]))
+    {
+        return 1;
+    }
+    cycles.resize(1);
+    while(reader.next(cycles.back()))
+    {
+        // keep carried over parameters and config for the next cycle
+        cycles.push_back(cycles.back());
+    }
+    cycles.pop_back();
+    if(cycles.empty())
+    {
+        fprintf(stderr, "no cycles recorded in %s\n", argv[1]);
+        return 1;
+    }
+
+    // in-process stand-ins for costmap, tf and prediction service
+    costmap_2d::Costmap2D costmap;
+    tf::Transformer transformer;
+    hanp_local_planner::HANPLocalPlanner planner;
+    copyCostmap(cycles[0].costmap, costmap);
+    planner.initializeReplay(&transformer, &costmap, cycles[0].costmap.header.frame_id,
+        cycles[0].footprint.header.frame_id, cycles[0].parameters, scoring_threads);
+
+    unsigned int replayed = 0, skipped = 0, differing = 0;
+    double max_difference = 0.0;
+    std::chrono::steady_clock::duration planning_time(0);
+
+    tf::Stamped<tf::Pose> pose, robot_vel;
+    std::vector<geometry_msgs::Point> footprint, unpadded_footprint;
+    std::vector<hanp_prediction::PredictedPoses> predicted_humans;
+    std::vector<double> predict_times;
+    for(unsigned int i = 0; i < cycles.size(); ++i)
+    {
+        auto& cycle = cycles[i];
+
+        // scales of critics depend on costmap resolution
+        copyCostmap(cycle.costmap, costmap);
+        if(cycle.config_changed)
+        {
+            auto config = hanp_local_planner::HANPLocalPlannerConfig::__getDefault__();
+            config.__fromMessage__(cycle.config);
+            planner.reconfigure(config);
+        }
+
+        for(const auto& transform_msg : cycle.prediction_transforms.transforms)
+        {
+            tf::StampedTransform transform;
+            tf::transformStampedMsgToTF(transform_msg, transform);
+            transformer.setTransform(transform, "replay_cycles");
+        }
+
+        predicted_humans = cycle.prediction_response.predicted_humans_poses;
+        predict_times = cycle.prediction_request.predict_times;
+        planner.getPredictionCache().setPredictions(predicted_humans, predict_times);
+
+        // stop-rotate needs the odometry and goal of the live planner
+        if(cycle.result == hanp_local_planner::CYCLE_STOP_ROTATE)
+        {
+            ++skipped;
+            continue;
+        }
+
+        tf::poseStampedMsgToTF(cycle.pose, pose);
+        robot_vel.setOrigin(tf::Vector3(cycle.velocity.linear.x, cycle.velocity.linear.y, 0.0));
+        robot_vel.setRotation(tf::createQuaternionFromYaw(cycle.velocity.angular.z));
+        footprintFromMsg(cycle.footprint.polygon, footprint);
+        footprintFromMsg(cycle.unpadded_footprint.polygon, unpadded_footprint);
+
+        geometry_msgs::Twist cmd_vel;
+        auto start = std::chrono::steady_clock::now();
+        bool succeeded = planner.replayCycle(pose, robot_vel, cycle.plan.poses, footprint, unpadded_footprint,
+            cmd_vel);
+        planning_time += std::chrono::steady_clock::now() - start;
+        ++replayed;
+
+        double difference = std::max(std::fabs(cmd_vel.linear.x - cycle.cmd_vel.linear.x),
+            std::max(std::fabs(cmd_vel.linear.y - cycle.cmd_vel.linear.y),
+                std::fabs(cmd_vel.angular.z - cycle.cmd_vel.angular.z)));
+        bool recorded_succeeded = cycle.result == hanp_local_planner::CYCLE_SUCCEEDED;
+        if(succeeded != recorded_succeeded || difference > tolerance)
+        {
+            if(differing < MAX_LISTED_DIFFERENCES)
+            {
+                printf("cycle %u: recorded %s (%.4f, %.4f, %.4f), replayed %s (%.4f, %.4f, %.4f)\n", i,
+                    recorded_succeeded ? "ok" : "failed", cycle.cmd_vel.linear.x, cycle.cmd_vel.linear.y,
+                    cycle.cmd_vel.angular.z, succeeded ? "ok" : "failed", cmd_vel.linear.x, cmd_vel.linear.y,
+                    cmd_vel.angular.z);
+            }
+            ++differing;
+            max_difference = std::max(max_difference, difference);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(planning_time).count();
+    printf("replayed %u cycles in %.3f s, %.1f cycles/sec, skipped %u stop-rotate cycles\n", replayed,
+        seconds, seconds > 0.0 ? replayed / seconds : 0.0, skipped);
+
+    printf("  %-16s %8s %10s %10s %10s %10s\n", "stage", "count", "p50 ms", "p99 ms", "max ms", "mean ms");
+    auto& stats = planner.getLatencyStats();
+    printStage(stats, hanp_local_planner::LatencyStats::COST_UPDATE);
+    printStage(stats, hanp_local_planner::LatencyStats::SEARCH);
+    printStage(stats, hanp_local_planner::LatencyStats::CONTEXT_SCALING);
+    printStage(stats, hanp_local_planner::LatencyStats::PUBLISH);
+    printStage(stats, hanp_local_planner::LatencyStats::CYCLE);
+    for(unsigned int counter = 0; counter < hanp_local_planner::LatencyStats::N_COUNTERS; ++counter)
+    {
+        auto name = hanp_local_planner::LatencyStats::counterName((hanp_local_planner::LatencyStats::Counter)counter);
+        printf("  %-20s %8lu\n", name,
+            (unsigned long)stats.collectCount((hanp_local_planner::LatencyStats::Counter)counter));
+    }
+
+    printf("%u of %u cycles differ from recorded cmd_vel (tolerance %g), maximum difference %g\n",
+        differing, replayed, tolerance, max_difference);
+
+    return 0;
+}
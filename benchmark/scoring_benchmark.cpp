@@ -0,0 +1,380 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// times the scoring hot paths on synthetic costmaps, plans and humans, without ROS master,
+// and prints results as JSON to follow scaling over human and sample counts
+//
+// usage: scoring_benchmark [minimum seconds per benchmark] [scoring threads] > results.json
+
+#define MIN_TIME 0.2 // seconds, every benchmark runs at least this long
+#define MIN_ITERATIONS 10 // every benchmark runs at least this many iterations
+#define RANDOM_SEED 42 // fixtures are the same in every run
+#define RESOLUTION 0.05 // meters, of generated costmaps
+#define GLOBAL_FRAME "odom"
+#define HUMANS_FRAME "map" // frame of half of the predicted humans, transformed to global frame
+#define BASE_FRAME "base_link"
+#define ROBOT_CLEARANCE 0.6 // meters, around the robot no obstacles are generated
+#define ROBOT_SPEED 0.3 // m/s, current robot velocity
+#define HUMAN_DISTANCE 6.0 // meters, maximum distance of generated humans from the robot
+#define HUMAN_SPEED 1.2 // m/s, maximum speed of generated humans
+#define HUMAN_RADIUS 0.3 // meters
+#define PREDICT_TIME 2.0 // seconds
+#define PREDICT_POINTS 20 // predicted poses per human
+#define ROBOT_POSES 20 // poses along the plan that cycles go through
+#define COMPATIBILITY_CALLS 1024 // getCompatabilty calls per iteration
+
+#include <hanp_local_planner/hanp_local_planner.h>
+#include <hanp_local_planner/latency_stats.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace hanp_local_planner
+{
+    class ScoringBenchmark
+    {
+    public:
+        ScoringBenchmark(double min_time, int scoring_threads) : min_time_(min_time),
+            scoring_threads_(scoring_threads), first_result_(true) {}
+
+        void run()
+        {
+            // predictions stay fresh however long benchmarks take
+            ContextCostFunction context_cost_function;
+            context_cost_function.initialize(GLOBAL_FRAME, &transformer_, boost::shared_ptr<PredictionSource>());
+            context_cost_function.setParams(2.09, 0.7, 10.0, 1.57, 0.05, PREDICT_TIME, PREDICT_POINTS, 10.0, 0.0);
+
+            tf::StampedTransform humans_transform(tf::Transform(tf::createQuaternionFromYaw(0.3),
+                tf::Vector3(1.0, -2.0, 0.0)), ros::Time::now(), GLOBAL_FRAME, HUMANS_FRAME);
+            transformer_.setTransform(humans_transform, "scoring_benchmark");
+
+            printf("{\n  \"benchmarks\": [");
+
+            benchmarkCompatibility(context_cost_function);
+            for(unsigned int humans : {0, 1, 10, 100, 500})
+            {
+                benchmarkTransformHumans(context_cost_function, humans);
+            }
+            for(unsigned int humans : {0, 1, 10, 100, 500})
+            {
+                for(unsigned int points : {10, 40})
+                {
+                    benchmarkScoreTrajectory(context_cost_function, humans, points);
+                }
+            }
+
+            HANPLocalPlanner planner;
+            makeCostmap(100, 0.0);
+            planner.initializeReplay(&transformer_, &costmap_, GLOBAL_FRAME, BASE_FRAME,
+                dynamic_reconfigure::Config(), scoring_threads_);
+            for(unsigned int cells : {100, 200, 400})
+            {
+                for(double density : {0.0, 0.05, 0.2})
+                {
+                    makeCostmap(cells, density);
+                    for(bool curved : {false, true})
+                    {
+                        makePlan(cells, curved);
+                        benchmarkUpdatePlanAndLocalCosts(planner, cells, density, curved);
+                        for(unsigned int vth_samples : {10, 20, 40})
+                        {
+                            benchmarkFindBestPath(planner, cells, density, curved, 3, vth_samples);
+                        }
+                    }
+                }
+            }
+
+            printf("\n  ]\n}\n");
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        double min_time_;
+        int scoring_threads_;
+        bool first_result_;
+
+        tf::Transformer transformer_;
+        costmap_2d::Costmap2D costmap_;
+        std::vector<geometry_msgs::PoseStamped> plan_;
+        std::vector<tf::Stamped<tf::Pose>> robot_poses_;
+
+        // runs setup untimed and operation timed, until both minimum time and iterations are reached
+        template<class Setup, class Operation>
+        void measure(const char* name, const std::string& params, unsigned int operations,
+            Setup setup, Operation operation)
+        {
+            LatencyHistogram histogram;
+            auto begin = Clock::now();
+            unsigned int iteration = 0;
+            while(iteration < MIN_ITERATIONS || std::chrono::duration<double>(Clock::now() - begin).count() < min_time_)
+            {
+                setup(iteration);
+                auto start = Clock::now();
+                operation(iteration);
+                histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+                ++iteration;
+            }
+
+            auto summary = histogram.collect(false);
+            printf("%s\n    {\"name\": \"%s\", \"params\": {%s}, \"iterations\": %lu, \"operations_per_iteration\": %u, "
+                "\"p50_ns\": %lu, \"p99_ns\": %lu, \"max_ns\": %lu, \"mean_ns\": %.1f}", first_result_ ? "" : ",",
+                name, params.c_str(), (unsigned long)summary.count, operations, (unsigned long)summary.p50,
+                (unsigned long)summary.p99, (unsigned long)summary.max, summary.mean);
+            fflush(stdout);
+            first_result_ = false;
+        }
+
+        static std::string format(const char* format_string, ...)
+        {
+            char buffer[256];
+            va_list args;
+            va_start(args, format_string);
+            vsnprintf(buffer, sizeof(buffer), format_string, args);
+            va_end(args);
+            return buffer;
+        }
+
+        void benchmarkCompatibility(ContextCostFunction& context_cost_function)
+        {
+            std::mt19937 random(RANDOM_SEED);
+            std::uniform_real_distribution<double> distance(0.0, 12.0), angle(0.0, M_PI);
+            std::vector<double> distances(COMPATIBILITY_CALLS), angles(COMPATIBILITY_CALLS);
+            for(unsigned int i = 0; i < COMPATIBILITY_CALLS; ++i)
+            {
+                distances[i] = distance(random);
+                angles[i] = angle(random);
+            }
+
+            volatile double sink = 0.0;
+            measure("getCompatabilty", "", COMPATIBILITY_CALLS, [](unsigned int) {},
+                [&](unsigned int)
+                {
+                    double sum = 0.0;
+                    for(unsigned int i = 0; i < COMPATIBILITY_CALLS; ++i)
+                    {
+                        sum += context_cost_function.getCompatabilty(distances[i], angles[i]);
+                    }
+                    sink = sink + sum;
+                });
+        }
+
+        void benchmarkTransformHumans(ContextCostFunction& context_cost_function, unsigned int humans)
+        {
+            std::vector<hanp_prediction::PredictedPoses> predicted_humans;
+            std::vector<double> predict_times;
+            makeHumans(humans, predicted_humans, predict_times);
+
+            measure("transformHumanPoses", format("\"humans\": %u", humans), 1, [](unsigned int) {},
+                [&](unsigned int) { context_cost_function.transformHumanPoses(predicted_humans); });
+        }
+
+        void benchmarkScoreTrajectory(ContextCostFunction& context_cost_function, unsigned int humans,
+            unsigned int points)
+        {
+            std::vector<hanp_prediction::PredictedPoses> predicted_humans;
+            std::vector<double> predict_times;
+            makeHumans(humans, predicted_humans, predict_times);
+            context_cost_function.getPredictionCache().setPredictions(predicted_humans, predict_times);
+
+            // straight ahead at full speed, scoring may truncate a copy of it
+            base_local_planner::Trajectory trajectory(0.5, 0.0, 0.0, PREDICT_TIME / points, points);
+            for(unsigned int i = 0; i < points; ++i)
+            {
+                trajectory.addPoint(0.5 * PREDICT_TIME * (i + 1) / points, 0.0, 0.0);
+            }
+            base_local_planner::Trajectory scored;
+
+            measure("scoreTrajectory", format("\"humans\": %u, \"trajectory_points\": %u", humans, points), 1,
+                [&](unsigned int) { scored = trajectory; },
+                [&](unsigned int) { context_cost_function.scoreTrajectory(scored); });
+        }
+
+        void benchmarkUpdatePlanAndLocalCosts(HANPLocalPlanner& planner, unsigned int cells, double density,
+            bool curved)
+        {
+            configure(planner, 3, 20);
+            measure("updatePlanAndLocalCosts", format("\"costmap_cells\": %u, \"obstacle_density\": %.2f, "
+                "\"plan\": \"%s\"", cells, density, curved ? "curved" : "straight"), 1, [](unsigned int) {},
+                [&](unsigned int iteration)
+                {
+                    planner.updatePlanAndLocalCosts(robot_poses_[iteration % robot_poses_.size()], plan_);
+                });
+        }
+
+        void benchmarkFindBestPath(HANPLocalPlanner& planner, unsigned int cells, double density, bool curved,
+            int vx_samples, int vth_samples)
+        {
+            configure(planner, vx_samples, vth_samples);
+            tf::Stamped<tf::Pose> robot_vel(tf::Pose(tf::createQuaternionFromYaw(0.0),
+                tf::Vector3(ROBOT_SPEED, 0.0, 0.0)), ros::Time::now(), BASE_FRAME);
+            tf::Stamped<tf::Pose> drive_velocities;
+
+            // vy_samples and the zero velocities VelocityIterator adds count too, so the
+            // number of sampled trajectories is taken from a first untimed search
+            planner.updatePlanAndLocalCosts(robot_poses_[0], plan_);
+            planner.findBestPath(robot_poses_[0], robot_vel, drive_velocities);
+            unsigned int samples = planner.sample_space_.samples().size();
+
+            measure("findBestPath", format("\"costmap_cells\": %u, \"obstacle_density\": %.2f, \"plan\": \"%s\", "
+                "\"samples\": %u", cells, density, curved ? "curved" : "straight", samples), 1,
+                [&](unsigned int iteration)
+                {
+                    planner.updatePlanAndLocalCosts(robot_poses_[iteration % robot_poses_.size()], plan_);
+                },
+                [&](unsigned int iteration)
+                {
+                    planner.findBestPath(robot_poses_[iteration % robot_poses_.size()], robot_vel,
+                        drive_velocities);
+                });
+        }
+
+        void configure(HANPLocalPlanner& planner, int vx_samples, int vth_samples)
+        {
+            auto config = HANPLocalPlannerConfig::__getDefault__();
+            config.vx_samples = vx_samples;
+            config.vth_samples = vth_samples;
+            planner.reconfigure(config);
+
+            // square robot of 0.6 m
+            planner.footprint_.resize(4);
+            for(unsigned int i = 0; i < 4; ++i)
+            {
+                planner.footprint_[i].x = (i == 0 || i == 3) ? 0.3 : -0.3;
+                planner.footprint_[i].y = (i < 2) ? 0.3 : -0.3;
+            }
+            planner.unpadded_footprint_ = planner.footprint_;
+        }
+
+        // random lethal cells, with free space around the robot in the center
+        void makeCostmap(unsigned int cells, double density)
+        {
+            costmap_.resizeMap(cells, cells, RESOLUTION, 0.0, 0.0);
+            std::mt19937 random(RANDOM_SEED);
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            double center = cells * RESOLUTION / 2.0;
+            for(unsigned int y = 0; y < cells; ++y)
+            {
+                for(unsigned int x = 0; x < cells; ++x)
+                {
+                    double wx, wy;
+                    costmap_.mapToWorld(x, y, wx, wy);
+                    bool lethal = uniform(random) < density &&
+                        hypot(wx - center, wy - center) > ROBOT_CLEARANCE;
+                    costmap_.getCharMap()[costmap_.getIndex(x, y)] =
+                        lethal ? costmap_2d::LETHAL_OBSTACLE : costmap_2d::FREE_SPACE;
+                }
+            }
+        }
+
+        // from center of costmap to its border, straight ahead or bending left,
+        // with one pose per cell, robot poses follow its beginning
+        void makePlan(unsigned int cells, bool curved)
+        {
+            double center = cells * RESOLUTION / 2.0;
+            double length = center - 2 * RESOLUTION;
+            double radius = length / (M_PI / 2.0);
+
+            plan_.clear();
+            for(double s = 0.0; s <= length; s += RESOLUTION)
+            {
+                geometry_msgs::PoseStamped pose;
+                pose.header.frame_id = GLOBAL_FRAME;
+                double yaw = curved ? s / radius : 0.0;
+                pose.pose.position.x = center + (curved ? radius * sin(yaw) : s);
+                pose.pose.position.y = center + (curved ? radius * (1.0 - cos(yaw)) : 0.0);
+                pose.pose.orientation = tf::createQuaternionMsgFromYaw(yaw);
+                plan_.push_back(pose);
+            }
+
+            robot_poses_.resize(ROBOT_POSES);
+            for(unsigned int i = 0; i < ROBOT_POSES; ++i)
+            {
+                tf::poseStampedMsgToTF(plan_[std::min<size_t>(i, plan_.size() - 1)], robot_poses_[i]);
+            }
+        }
+
+        // humans walking in random directions around the robot, half of them in another frame
+        void makeHumans(unsigned int humans, std::vector<hanp_prediction::PredictedPoses>& predicted_humans,
+            std::vector<double>& predict_times)
+        {
+            std::mt19937 random(RANDOM_SEED);
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+            // same grid as HumanPredictionCache, starting at the current pose
+            predict_times.resize(PREDICT_POINTS + 1);
+            for(unsigned int i = 0; i <= PREDICT_POINTS; ++i)
+            {
+                predict_times[i] = PREDICT_TIME * i / PREDICT_POINTS;
+            }
+
+            auto stamp = ros::Time::now();
+            predicted_humans.resize(humans);
+            for(unsigned int human = 0; human < humans; ++human)
+            {
+                double distance = HUMAN_DISTANCE * uniform(random);
+                double direction = 2 * M_PI * uniform(random);
+                double heading = 2 * M_PI * uniform(random);
+                double speed = HUMAN_SPEED * uniform(random);
+
+                auto& predicted_human = predicted_humans[human];
+                predicted_human.id = human;
+                predicted_human.poses.resize(predict_times.size());
+                for(unsigned int i = 0; i < predict_times.size(); ++i)
+                {
+                    auto& pose = predicted_human.poses[i];
+                    pose.header.frame_id = (human % 2) ? HUMANS_FRAME : GLOBAL_FRAME;
+                    pose.header.stamp = stamp;
+                    pose.pose.pose.position.x = distance * cos(direction) + speed * predict_times[i] * cos(heading);
+                    pose.pose.pose.position.y = distance * sin(direction) + speed * predict_times[i] * sin(heading);
+                    pose.pose.pose.orientation = tf::createQuaternionMsgFromYaw(heading);
+                    pose.pose.covariance[0] = HUMAN_RADIUS;
+                    pose.pose.covariance[7] = HUMAN_RADIUS;
+                }
+            }
+        }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    double min_time = argc > 1 ? atof(argv[1]) : MIN_TIME;
+    int scoring_threads = argc > 2 ? atoi(argv[2]) : (int)boost::thread::hardware_concurrency();
+
+    // wall time, without ros::init nothing tries to reach the ROS master
+    ros::Time::init();
+
+    hanp_local_planner::ScoringBenchmark benchmark(min_time, scoring_threads);
+    benchmark.run();
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BATCH_ROLLOUT_H_
+#define BATCH_ROLLOUT_H_
+
+#include <vector>
+#include <Eigen/Core>
+
+#include <base_local_planner/trajectory.h>
+#include <base_local_planner/local_planner_limits.h>
+
+#include <hanp_local_planner/velocity_sample_space.h>
+
+namespace hanp_local_planner {
+
+    // rolls out all velocity samples of a cycle at once, like SimpleTrajectoryGenerator
+    // does one by one, into one structure-of-arrays buffer. Row k of x(), y(), th()
+    // holds the poses of all samples at time step k, so the integration runs with
+    // SIMD across samples.
+    class BatchRollout
+    {
+    public:
+        typedef Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> StepArray;
+        typedef Eigen::Array<float, 1, Eigen::Dynamic> LaneArray;
+
+        BatchRollout();
+
+        // same parameters as SimpleTrajectoryGenerator::setParameters
+        void setParameters(double sim_time, double sim_granularity, double angular_sim_granularity, bool use_dwa);
+
+        void rollout(const VelocitySampleSpace& sample_space, const base_local_planner::LocalPlannerLimits& limits);
+
+        // copies rollouts done from the origin of the robot frame, rigidly transformed to the pose of
+        // sample_space. Samples outside of its feasible velocity space are dropped, and the first
+        // step is ramped up from its current velocity instead of the one of the primitives.
+        void transform(const BatchRollout& primitives, const VelocitySampleSpace& sample_space,
+            const base_local_planner::LocalPlannerLimits& limits);
+
+        // largest number of time steps of the samples, the rows rollout needs
+        unsigned int maxSteps(const VelocitySampleSpace& sample_space,
+            const base_local_planner::LocalPlannerLimits& limits) const;
+
+        unsigned int size() const { return num_steps_.size(); }
+        // number of valid time steps of a sample, 0 if no trajectory could be generated for it
+        unsigned int steps(unsigned int sample) const { return num_steps_[sample]; }
+
+        const StepArray& x() const { return x_; }
+        const StepArray& y() const { return y_; }
+        const StepArray& th() const { return th_; }
+
+        // copies one sample into a trajectory, reusing the point storage of traj
+        bool getTrajectory(unsigned int sample, base_local_planner::Trajectory& traj) const;
+
+    private:
+        double sim_time_, sim_granularity_, angular_sim_granularity_;
+        bool continued_acceleration_;
+
+        std::vector<unsigned int> num_steps_;
+        LaneArray target_x_, target_y_, target_th_, xv_, yv_, thetav_, dt_;
+        LaneArray vel_x_, vel_y_, vel_th_, pos_x_, pos_y_, pos_th_;
+        LaneArray cos_th_, sin_th_, acc_dt_x_, acc_dt_y_, acc_dt_th_;
+        StepArray x_, y_, th_;
+
+        // number of time steps of a sample, 0 if no trajectory is generated for it
+        unsigned int numSteps(const Eigen::Vector3f& sample, const base_local_planner::LocalPlannerLimits& limits) const;
+
+        void resizeLanes(unsigned int n);
+
+        // ramps velocities of all samples towards their target, as SimpleTrajectoryGenerator::computeNewVelocities
+        void computeNewVelocities();
+    };
+}
+
+#endif // BATCH_ROLLOUT_H_
@@ -0,0 +1,96 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COARSE_TO_FINE_SEARCH_H_
+#define COARSE_TO_FINE_SEARCH_H_
+
+#include <vector>
+#include <Eigen/Core>
+
+#include <base_local_planner/trajectory.h>
+#include <base_local_planner/local_planner_limits.h>
+
+#include <hanp_local_planner/velocity_sample_space.h>
+#include <hanp_local_planner/batch_rollout.h>
+#include <hanp_local_planner/parallel_scored_sampling_planner.h>
+
+namespace hanp_local_planner {
+
+    // hierarchical alternative to scoring the dense velocity grid: scores the
+    // coarse grid of the sample space, then repeatedly samples a finer grid
+    // around the top_k best velocities found so far
+    class CoarseToFineSearch
+    {
+    public:
+        CoarseToFineSearch();
+
+        void initialize(VelocitySampleSpace* sample_space, BatchRollout* rollout,
+            ParallelScoredSamplingPlanner* planner);
+
+        // refine_samples per dimension around each refined velocity (made odd),
+        // levels of refinement after the coarse grid
+        void setParameters(int refine_samples, int top_k, int levels);
+
+        // sample_space must be initialised with the coarse grid for current cycle,
+        // its samples are replaced by those of each level
+        bool findBestTrajectory(const base_local_planner::LocalPlannerLimits& limits,
+            base_local_planner::Trajectory& traj, std::vector<base_local_planner::Trajectory>* all_explored = 0);
+
+        // whether last findBestTrajectory returned a trajectory scored with the fallback critic
+        bool usedFallback() const { return used_fallback_; }
+
+    private:
+        // a scored velocity and the grid spacing to refine around it with,
+        // fallback if its cost is only valid with the fallback critic
+        struct Candidate
+        {
+            Eigen::Vector3f vel, spacing;
+            double cost;
+            bool fallback;
+        };
+
+        VelocitySampleSpace* sample_space_;
+        BatchRollout* rollout_;
+        ParallelScoredSamplingPlanner* planner_;
+        int refine_radius_, top_k_, levels_;
+        bool used_fallback_;
+
+        // all velocities scored in current cycle, and those of the level being scored
+        std::vector<Candidate> candidates_, level_;
+        std::vector<Eigen::Vector3f> samples_;
+        std::vector<double> costs_, fallback_costs_;
+        std::vector<unsigned int> order_;
+        base_local_planner::Trajectory loop_traj_, best_traj_, fallback_traj_;
+
+        // rolls out and scores level_, moves it to candidates_
+        void scoreLevel(const base_local_planner::LocalPlannerLimits& limits,
+            std::vector<base_local_planner::Trajectory>* all_explored);
+        bool isSampled(const Eigen::Vector3f& vel, const Eigen::Vector3f& spacing) const;
+    };
+}
+
+#endif // COARSE_TO_FINE_SEARCH_H_
@@ -0,0 +1,98 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPATIBILITY_KERNEL_H_
+#define COMPATIBILITY_KERNEL_H_
+
+#include <vector>
+
+namespace hanp_local_planner {
+
+    // evaluates human-robot compatibility for all humans and all trajectory points at once.
+    //
+    // Only whether compatibility reaches 0 matters for truncating a trajectory, so the kernel
+    // computes that directly: a point is incompatible with a human if the human is not behind
+    // the robot (angle from robot heading to human-to-robot direction not below beta) and
+    // either d_p <= d_low, or d_p < d_high with robot facing the human head on (alpha = 0).
+    //
+    // Humans are behind the robot if dot(robot - human, robot heading) > cos(beta) * |robot - human|,
+    // which needs no atan2. Human yaw is computed from quaternion with fastAtan2, whose absolute
+    // error is below ATAN2_MAX_ERROR radians, the head-on test uses that as tolerance. Positions
+    // are stored in single precision relative to an origin given at reset, so the error of d_p
+    // grows with the distance of the poses from that origin rather than from the frame origin:
+    // it stays below 1e-6 m per meter of that distance, e.g. 1e-5 m for poses within 10 m.
+    //
+    // With AVX2 available at run time, 8 trajectory points are evaluated per instruction,
+    // otherwise the same single precision arithmetic runs as scalar code.
+    class CompatibilityKernel
+    {
+    public:
+        // upper bound of the absolute error of fastAtan2, in radians
+        static constexpr float ATAN2_MAX_ERROR = 1e-5f;
+
+        CompatibilityKernel();
+
+        void setParams(double alpha_max, double d_low, double d_high, double beta);
+
+        // prepares for a trajectory of given number of points, removes all humans,
+        // robot and human positions are stored relative to the origin, best the first robot pose
+        void reset(unsigned int points, double origin_x, double origin_y);
+        void setRobotPose(unsigned int point, double x, double y, double theta);
+
+        // returns index of the new human row, poses of all points must be set
+        unsigned int addHuman();
+        void setHumanPose(unsigned int human, unsigned int point, double x, double y,
+            double qx, double qy, double qz, double qw, double radius);
+
+        // number of leading points before and including the first incompatible one over
+        // all humans, as point_index_max of the scalar scoring loop, starting from limit
+        unsigned int pointIndexMax(unsigned int limit) const;
+
+        unsigned int humans() const { return humans_; }
+        bool usesAVX2() const { return use_avx2_; }
+
+        static float fastAtan2(float y, float x);
+
+    private:
+        float alpha_max_, d_low_, d_high_, cos_beta_;
+        double origin_x_, origin_y_;
+
+        unsigned int points_, stride_, humans_;
+        bool use_avx2_;
+
+        // robot poses, one entry per trajectory point
+        std::vector<float> rx_, ry_, rth_, rcos_, rsin_;
+        // human poses, one row of stride_ entries per human
+        std::vector<float> hx_, hy_, hqx_, hqy_, hqz_, hqw_, hr_;
+
+        unsigned int firstIncompatible(unsigned int human, unsigned int end) const;
+        unsigned int firstIncompatibleScalar(unsigned int human, unsigned int begin, unsigned int end) const;
+        unsigned int firstIncompatibleAVX2(unsigned int human, unsigned int end) const;
+    };
+}
+
+#endif // COMPATIBILITY_KERNEL_H_
@@ -30,11 +30,17 @@
 #ifndef CONTEXT_COST_FUNCTION_H_
 #define CONTEXT_COST_FUNCTION_H_
 
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
 #include <base_local_planner/trajectory_cost_function.h>
 #include <tf/transform_listener.h>
 #include <angles/angles.h>
 #include <hanp_prediction/HumanPosePredict.h>
 #include <std_srvs/SetBool.h>
+#include <hanp_local_planner/human_prediction_cache.h>
+#include <hanp_local_planner/compatibility_kernel.h>
+#include <hanp_local_planner/human_spatial_index.h>
 
 namespace hanp_local_planner {
 
@@ -46,17 +52,46 @@ namespace hanp_local_planner {
         ContextCostFunction();
         ~ContextCostFunction();
 
-        void initialize(std::string global_frame, tf::TransformListener* tf);
+        // predictions are prefetched from prediction_source, if it is null
+        // they have to be set in the prediction cache
+        void initialize(std::string global_frame, tf::Transformer* tf,
+            boost::shared_ptr<PredictionSource> prediction_source);
         bool prepare();
         double scoreTrajectory(base_local_planner::Trajectory &traj);
 
         void setParams(double alpha_max, double d_low, double d_high, double beta,
-            double min_scale, double predict_time, bool publish_predicted_human_markers);
+            double min_scale, double predict_time, int prediction_points, double prediction_rate,
+            double prediction_max_age);
+
+        // calls the marker service of the prediction server, keep it off the control thread
+        void setPublishPredictedHumanMarkers(bool publish_predicted_human_markers);
+
+        // instead of one predicted pose per trajectory point, treats robot and humans as moving
+        // linearly between their poses and checks compatibility at the closest approaches only
+        void setClosestApproach(bool closest_approach);
+
+        // reuses the scale of one of the last scored trajectories if predictions have the same
+        // humans and stamps, and trajectory points are the same up to a centimeter
+        void setMemoize(bool memoize);
+        unsigned long memoHits() const { return memo_hits_; }
+        unsigned long memoMisses() const { return memo_misses_; }
+
+        HumanPredictionCache& getPredictionCache() { return prediction_cache_; }
+
+        // copies the predictions every scored trajectory used, for recording them, and
+        // forgets the last copy
+        void setKeepScoredPredictions(bool keep_scored_predictions);
+        // predictions the last scored trajectory used, invalid if it used none
+        const PredictionSnapshot& scoredPredictions() const { return scored_predictions_; }
 
     private:
-        ros::ServiceClient predict_humans_client_, publish_predicted_markers_client_;
+        ros::ServiceClient publish_predicted_markers_client_;
+        HumanPredictionCache prediction_cache_;
+        CompatibilityKernel compatibility_kernel_;
+        HumanSpatialIndex human_index_;
+        std::vector<unsigned int> nearby_humans_;
 
-        tf::TransformListener* tf_;
+        tf::Transformer* tf_;
 
         double alpha_max_, d_low_, d_high_, beta_, min_scale_;
         double predict_time_;
@@ -64,9 +99,93 @@ namespace hanp_local_planner {
 
         double getCompatabilty(double d_p, double alpha);
 
-        hanp_prediction::PredictedPoses transformHumanPoses(hanp_prediction::PredictedPoses&);
+        // transform of a prediction frame to global frame, looked up once for every stamp
+        struct FrameTransform
+        {
+            std::string frame_id;
+            ros::Time stamp;
+            bool valid, identity;
+            double qx, qy, qz, qw;
+            Eigen::Matrix3d rotation;
+            Eigen::Vector3d translation;
+        };
+        std::vector<FrameTransform> frame_transforms_;
+
+        // positions of all predicted poses in global frame, poses of human h are in columns
+        // human_offsets_[h] to human_offsets_[h + 1], transformed with human_transforms_[h]
+        Eigen::Matrix3Xd human_positions_;
+        std::vector<unsigned int> human_offsets_;
+        std::vector<int> human_transforms_;
+
+        // x, y and theta of trajectory points in closest approach mode
+        Eigen::Matrix3Xd robot_poses_;
+
+        // returns index in frame_transforms_, -1 if frame cannot be transformed
+        int getFrameTransform(const std::string& frame_id, const ros::Time& stamp);
+        void transformHumanPoses(const std::vector<hanp_prediction::PredictedPoses>& predicted_humans);
+
+        // ids, pose counts and stamps of all predicted humans, with their frames
+        struct PredictionsKey
+        {
+            std::vector<uint64_t> values;
+            std::vector<std::string> frame_ids;
+
+            bool operator==(const PredictionsKey& other) const
+            {
+                return values == other.values && frame_ids == other.frame_ids;
+            }
+        };
+
+        struct MemoEntry
+        {
+            PredictionsKey predictions_key;
+            std::vector<long> signature; // quantized x, y and theta of all points
+            double scale;
+            bool valid = false;
+        };
+        std::vector<MemoEntry> memo_;
+        unsigned int memo_next_; // entry replaced next
+        std::vector<long> signature_;
+        PredictionsKey predictions_key_;
+        bool memoize_ = false;
+        unsigned long memo_hits_ = 0, memo_misses_ = 0;
+
+        void clearMemo();
+        void predictionsKey(const PredictionSnapshot& predictions, PredictionsKey& key) const;
+        // whether all humans were transformed with transforms of their own stamps
+        bool transformsCurrent(const PredictionSnapshot& predictions) const;
+        double trajectoryScale(base_local_planner::Trajectory& traj, const PredictionSnapshot& predictions);
+
+        // pose of a human in global frame at a time between predicted times
+        struct HumanState
+        {
+            Eigen::Vector2d position;
+            Eigen::Quaterniond orientation;
+            double radius;
+        };
+
+        // interpolates position, orientation and covariance radius between the predicted poses
+        // around time t, next_knot being the index of the first of the knots predicted times after t
+        void interpolateHuman(unsigned int human, const PredictionSnapshot& predictions, unsigned int knots,
+            unsigned int next_knot, double t, HumanState& state) const;
+        // same for position and radius only, leaving orientation as is
+        void interpolateHumanPosition(unsigned int human, const PredictionSnapshot& predictions, unsigned int knots,
+            unsigned int next_knot, double t, HumanState& state) const;
+        // same for orientation only, the slerp and frame rotation are the costly part
+        void interpolateHumanOrientation(unsigned int human, const PredictionSnapshot& predictions,
+            unsigned int knots, unsigned int next_knot, double t, HumanState& state) const;
+
+        // earliest time at which a nearby human gets incompatible, predict_time_ if none does,
+        // starting at the time of the first trajectory point
+        double closestApproachTime(base_local_planner::Trajectory& traj, const PredictionSnapshot& predictions);
 
         bool publish_predicted_human_markers_ = false;
+        bool closest_approach_ = false;
+        bool keep_scored_predictions_ = false;
+        PredictionSnapshot scored_predictions_;
+
+        // times private stages, see benchmark/scoring_benchmark.cpp
+        friend class ScoringBenchmark;
     };
 }
 
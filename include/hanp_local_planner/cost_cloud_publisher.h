@@ -0,0 +1,103 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COST_CLOUD_PUBLISHER_H_
+#define COST_CLOUD_PUBLISHER_H_
+
+#include <atomic>
+#include <vector>
+#include <Eigen/Core>
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+#include <pcl_ros/publisher.h>
+#include <base_local_planner/map_grid_cost_point.h>
+
+namespace hanp_local_planner {
+
+    // path, goal and occupancy grids of one cycle, from which the cost cloud is composed
+    struct CostGridSnapshot
+    {
+        unsigned int size_x = 0, size_y = 0;
+        double resolution = 0.0, origin_x = 0.0, origin_y = 0.0;
+        std::vector<float> path_costs, goal_costs;
+        std::vector<unsigned char> occ_costs;
+        // path costs of obstacle and unreachable cells
+        float obstacle_costs = 0.0, unreachable_costs = 0.0;
+        float path_scale = 0.0, goal_scale = 0.0, occ_scale = 0.0;
+
+        // whether the same cloud would be composed from both snapshots
+        bool sameAs(const CostGridSnapshot& other) const;
+    };
+
+    // publishes the cost cloud of base_local_planner::MapGridVisualizer from a background thread,
+    // the control thread only copies the grids into a snapshot at a low rate
+    class CostCloudPublisher
+    {
+    public:
+        CostCloudPublisher();
+        ~CostCloudPublisher();
+
+        void initialize(ros::NodeHandle& nh, const std::string& frame_id);
+
+        void setParams(double max_rate);
+
+        // whether a snapshot would be published now, so that grids are only copied then
+        bool ready() const;
+
+        // snapshot to fill by the control thread before publish
+        CostGridSnapshot& snapshot() { return *back_; }
+
+        // hands the snapshot to the publishing thread, replacing one not taken yet
+        void publish();
+
+    private:
+        pcl_ros::Publisher<base_local_planner::MapGridCostPoint> publisher_;
+        std::string frame_id_;
+        boost::thread* publish_thread_;
+
+        // filled by control thread, handed off, being composed, and last published
+        CostGridSnapshot snapshots_[4];
+        CostGridSnapshot *back_, *pending_, *current_, *published_;
+        boost::mutex mutex_;
+        boost::condition_variable queued_;
+        bool has_pending_;
+
+        std::atomic<double> min_period_;
+        ros::WallTime last_publish_; // only touched by control thread
+
+        // only touched by publishing thread
+        pcl::PointCloud<base_local_planner::MapGridCostPoint> cloud_;
+        Eigen::ArrayXf occ_row_, total_row_;
+        Eigen::Array<bool, Eigen::Dynamic, 1> valid_row_;
+
+        void publishThread();
+        void compose(const CostGridSnapshot& snapshot);
+    };
+}
+
+#endif // COST_CLOUD_PUBLISHER_H_
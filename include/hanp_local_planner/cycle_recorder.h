@@ -0,0 +1,140 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CYCLE_RECORDER_H_
+#define CYCLE_RECORDER_H_
+
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <tf/transform_listener.h>
+#include <tf/tfMessage.h>
+#include <costmap_2d/costmap_2d.h>
+#include <dynamic_reconfigure/Config.h>
+#include <geometry_msgs/PolygonStamped.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/Twist.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <nav_msgs/Path.h>
+#include <std_msgs/UInt8.h>
+#include <hanp_prediction/HumanPosePredict.h>
+
+#include <hanp_local_planner/HANPLocalPlannerConfig.h>
+#include <hanp_local_planner/human_prediction_cache.h>
+
+namespace hanp_local_planner {
+
+    enum CycleResult { CYCLE_FAILED = 0, CYCLE_SUCCEEDED, CYCLE_STOP_ROTATE };
+
+    // inputs and outputs of one control cycle, parameters and config are
+    // carried over from earlier cycles when they did not change
+    struct RecordedCycle
+    {
+        dynamic_reconfigure::Config parameters;
+        dynamic_reconfigure::Config config;
+        bool config_changed = false;
+
+        nav_msgs::OccupancyGrid costmap;
+        geometry_msgs::PoseStamped pose;
+        geometry_msgs::Twist velocity;
+        nav_msgs::Path plan;
+        geometry_msgs::PolygonStamped footprint, unpadded_footprint;
+        hanp_prediction::HumanPosePredictRequest prediction_request;
+        hanp_prediction::HumanPosePredictResponse prediction_response;
+        tf::tfMessage prediction_transforms;
+
+        geometry_msgs::Twist cmd_vel;
+        uint8_t result = CYCLE_FAILED;
+    };
+
+    // writes planner inputs of every control cycle into a bag file, so that
+    // cycles can be replayed without robot, see benchmark/replay_cycles.cpp
+    class CycleRecorder
+    {
+    public:
+        CycleRecorder();
+        ~CycleRecorder();
+
+        // parameters are the startup parameters that replaying needs, written once
+        bool open(std::string file_name, tf::Transformer* tf, std::string global_frame,
+            std::string base_frame, const dynamic_reconfigure::Config& parameters);
+        void close();
+        bool isOpen() const { return open_; }
+
+        // config is written with next recorded cycle, can be called from any thread
+        void setConfig(const HANPLocalPlannerConfig& config);
+
+        // predictions are the ones used for scoring the cycle, recorded as no humans if invalid
+        void record(const costmap_2d::Costmap2D& costmap, const tf::Stamped<tf::Pose>& pose,
+            const tf::Stamped<tf::Pose>& velocity, const std::vector<geometry_msgs::PoseStamped>& plan,
+            const std::vector<geometry_msgs::Point>& footprint,
+            const std::vector<geometry_msgs::Point>& unpadded_footprint,
+            const PredictionSnapshot& predictions, const geometry_msgs::Twist& cmd_vel, CycleResult result);
+
+    private:
+        rosbag::Bag bag_;
+        bool open_;
+        tf::Transformer* tf_;
+        std::string global_frame_, base_frame_;
+        unsigned int cycles_;
+
+        // views order messages by time only, so every message gets its own time
+        ros::Time last_time_;
+        ros::Time nextTime();
+
+        boost::mutex config_mutex_;
+        dynamic_reconfigure::Config config_;
+        bool config_changed_;
+
+        // reused between cycles
+        RecordedCycle cycle_;
+    };
+
+    // reads cycles written by CycleRecorder in recorded order
+    class CycleReader
+    {
+    public:
+        CycleReader();
+        ~CycleReader();
+
+        bool open(std::string file_name);
+
+        // false at end of file, a cycle cut off at the end is dropped
+        bool next(RecordedCycle& cycle);
+
+    private:
+        rosbag::Bag bag_;
+        rosbag::View* view_;
+        rosbag::View::iterator message_;
+    };
+}
+
+#endif // CYCLE_RECORDER_H_
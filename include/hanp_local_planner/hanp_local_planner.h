@@ -57,9 +57,8 @@
 
 #include <costmap_2d/costmap_2d_ros.h>
 #include <nav_core/base_local_planner.h>
+#include <pluginlib/class_loader.h>
 
-#include <pcl_ros/publisher.h>
-#include <base_local_planner/map_grid_visualizer.h>
 #include <base_local_planner/latched_stop_rotate_controller.h>
 #include <base_local_planner/odometry_helper_ros.h>
 #include <base_local_planner/trajectory.h>
@@ -68,11 +67,22 @@
 #include <base_local_planner/simple_trajectory_generator.h>
 #include <base_local_planner/oscillation_cost_function.h>
 #include <base_local_planner/map_grid_cost_function.h>
-#include <base_local_planner/obstacle_cost_function.h>
 #include <base_local_planner/prefer_forward_cost_function.h>
 #include <base_local_planner/simple_scored_sampling_planner.h>
 
 #include <hanp_local_planner/context_cost_function.h>
+#include <hanp_local_planner/velocity_sample_space.h>
+#include <hanp_local_planner/batch_rollout.h>
+#include <hanp_local_planner/parallel_scored_sampling_planner.h>
+#include <hanp_local_planner/coarse_to_fine_search.h>
+#include <hanp_local_planner/motion_primitive_library.h>
+#include <hanp_local_planner/path_distance_cost_function.h>
+#include <hanp_local_planner/obstacle_cost_function.h>
+#include <hanp_local_planner/latency_stats.h>
+#include <hanp_local_planner/cycle_recorder.h>
+#include <hanp_local_planner/trajectory_cloud_publisher.h>
+#include <hanp_local_planner/cost_cloud_publisher.h>
+#include <hanp_local_planner/plan_publisher.h>
 
 namespace hanp_local_planner
 {
@@ -93,7 +103,8 @@ namespace hanp_local_planner
         bool computeVelocityCommands(geometry_msgs::Twist& cmd_vel);
 
         bool computeVelocityCommandsAccErrors(geometry_msgs::Twist& cmd_vel);
-        bool hanpComputeVelocityCommands(tf::Stamped<tf::Pose>& global_pose, geometry_msgs::Twist& cmd_vel);
+        bool hanpComputeVelocityCommands(tf::Stamped<tf::Pose>& global_pose, const tf::Stamped<tf::Pose>& robot_vel,
+            geometry_msgs::Twist& cmd_vel);
 
         bool setPlan(const std::vector<geometry_msgs::PoseStamped>& orig_global_plan);
 
@@ -103,26 +114,62 @@ namespace hanp_local_planner
             return initialized_;
         }
 
+        // sets up the planner without ROS master, for replaying recorded cycles with
+        // in-process costmap and transforms, predictions have to be set in prediction cache
+        void initializeReplay(tf::Transformer* tf, costmap_2d::Costmap2D* costmap, std::string global_frame,
+            std::string base_frame, const dynamic_reconfigure::Config& parameters, int scoring_threads);
+        // applies the configuration right away, replay has no separate reconfigure thread
+        void reconfigure(HANPLocalPlannerConfig& config)
+        {
+            reconfigureCB(config, 0);
+            updateConfig();
+        }
+        // runs one non stop-rotate cycle on the given inputs
+        bool replayCycle(tf::Stamped<tf::Pose>& global_pose, const tf::Stamped<tf::Pose>& robot_vel,
+            const std::vector<geometry_msgs::PoseStamped>& transformed_plan,
+            const std::vector<geometry_msgs::Point>& footprint,
+            const std::vector<geometry_msgs::Point>& unpadded_footprint, geometry_msgs::Twist& cmd_vel);
+        HumanPredictionCache& getPredictionCache() { return context_cost_function_->getPredictionCache(); }
+        LatencyStats& getLatencyStats() { return latency_stats_; }
+
         // DWAPlanner(std::string name, base_local_planner::LocalPlannerUtil *planner_util);
         // ~DWAPlanner() {if(traj_cloud_) delete traj_cloud_;}
 
     private:
         bool initialized_;
         bool setup_;
-        std::stringstream calc_times_;
+        LatencyStats latency_stats_;
         bool print_calc_times_ = false;
 
-        void reconfigureCB(HANPLocalPlannerConfig &config, uint32_t level);
-
-        void publishLocalPlan(std::vector<geometry_msgs::PoseStamped>& path);
-        void publishGlobalPlan(std::vector<geometry_msgs::PoseStamped>& path);
+        // tunables of one reconfiguration, never modified once published by reconfigureCB,
+        // the control thread applies a new snapshot at the start of a cycle
+        struct ConfigSnapshot
+        {
+            HANPLocalPlannerConfig config;
+            base_local_planner::LocalPlannerLimits limits;
+            Eigen::Vector3f vsamples;
+            // NULL if disabled, built by reconfigureCB
+            boost::shared_ptr<const MotionPrimitiveLibrary> motion_primitives;
+        };
 
-        bool getCellCosts(int cx, int cy, float &path_cost, float &goal_cost, float &occ_cost, float &total_cost);
+        void reconfigureCB(HANPLocalPlannerConfig &config, uint32_t level);
+        // applies the latest snapshot if it changed, only called by the control thread
+        void updateConfig();
+        void applyConfig(const ConfigSnapshot& snapshot);
+        void initializeCostFunctions(tf::Transformer* tf, boost::shared_ptr<PredictionSource> prediction_source,
+            bool sum_scores, int scoring_threads);
+
+        void publishLocalPlan(const base_local_planner::Trajectory& traj);
+        void publishLocalPlan(const tf::Pose& pose, const std::string& frame_id);
+        void publishGlobalPlan(const std::vector<geometry_msgs::PoseStamped>& path);
+
+        // copies the grids the cost point-cloud is composed from
+        void fillCostGridSnapshot(hanp_local_planner::CostGridSnapshot& snapshot);
         bool checkTrajectory(const Eigen::Vector3f pos, const Eigen::Vector3f vel, const Eigen::Vector3f vel_samples);
         void updatePlanAndLocalCosts(tf::Stamped<tf::Pose> global_pose, const std::vector<geometry_msgs::PoseStamped>& new_plan);
+        // scores trajectories with footprint_, and with unpadded_footprint_ only if none is valid
         base_local_planner::Trajectory findBestPath(tf::Stamped<tf::Pose> global_pose,
-            tf::Stamped<tf::Pose> global_vel, tf::Stamped<tf::Pose>& drive_velocities,
-            std::vector<geometry_msgs::Point> footprint_spec);
+            tf::Stamped<tf::Pose> global_vel, tf::Stamped<tf::Pose>& drive_velocities);
 
         costmap_2d::Costmap2DROS* costmap_ros_;
         tf::TransformListener* tf_;
@@ -130,20 +177,27 @@ namespace hanp_local_planner
         dynamic_reconfigure::Server<HANPLocalPlannerConfig> *dsrv_;
         hanp_local_planner::HANPLocalPlannerConfig default_config_;
 
-        ros::Publisher g_plan_pub_, l_plan_pub_;
+        hanp_local_planner::PlanPublisher plan_pub_;
+        std::string global_frame_, base_frame_;
         std::string odom_topic_;
 
         tf::Stamped<tf::Pose> current_pose_;
+        std::vector<geometry_msgs::Point> footprint_, unpadded_footprint_;
+        CycleRecorder recorder_;
 
         double stop_time_buffer_;
         double pdist_scale_, gdist_scale_, occdist_scale_;
         Eigen::Vector3f vsamples_;
+        bool hierarchical_sampling_;
+        Eigen::Vector3f hs_vsamples_;
         double sim_period_, sim_time_;
         double forward_point_distance_, forward_point_distance_mul_fac_;
         std::vector<geometry_msgs::PoseStamped> global_plan_;
-        boost::mutex configuration_mutex_;
-        pcl::PointCloud<base_local_planner::MapGridCostPoint>* traj_cloud_;
-        pcl_ros::Publisher<base_local_planner::MapGridCostPoint> traj_cloud_pub_;
+        // only accessed through boost::atomic_load and boost::atomic_store
+        boost::shared_ptr<const ConfigSnapshot> config_;
+        boost::shared_ptr<const ConfigSnapshot> applied_config_; // only touched by control thread
+        hanp_local_planner::TrajectoryCloudPublisher traj_cloud_pub_;
+        hanp_local_planner::CostCloudPublisher cost_cloud_pub_;
         bool publish_cost_grid_pc_;
         bool publish_traj_pc_;
         double cheat_factor_;
@@ -154,20 +208,29 @@ namespace hanp_local_planner
         base_local_planner::OdometryHelperRos odom_helper_;
         base_local_planner::LocalPlannerUtil planner_util_;
         base_local_planner::Trajectory result_traj_;
-        base_local_planner::MapGridVisualizer map_viz_;
         base_local_planner::SimpleTrajectoryGenerator generator_;
         base_local_planner::OscillationCostFunction oscillation_costs_;
-        base_local_planner::ObstacleCostFunction* obstacle_costs_;
-        base_local_planner::MapGridCostFunction* path_costs_;
+        hanp_local_planner::ObstacleCostFunction* obstacle_costs_;
+        hanp_local_planner::ObstacleCostFunction* unpadded_obstacle_costs_;
+        hanp_local_planner::PathDistanceCostFunction* path_costs_;
         base_local_planner::MapGridCostFunction* goal_costs_;
-        base_local_planner::MapGridCostFunction* goal_front_costs_;
+        hanp_local_planner::PathDistanceCostFunction* goal_front_costs_;
         base_local_planner::MapGridCostFunction* alignment_costs_;
         base_local_planner::PreferForwardCostFunction* prefer_forward_costs_;
         base_local_planner::SimpleScoredSamplingPlanner scored_sampling_planner_;
+        hanp_local_planner::VelocitySampleSpace sample_space_;
+        hanp_local_planner::BatchRollout batch_rollout_;
+        boost::shared_ptr<const MotionPrimitiveLibrary> motion_primitives_;
+        hanp_local_planner::ParallelScoredSamplingPlanner parallel_planner_;
+        hanp_local_planner::CoarseToFineSearch coarse_to_fine_search_;
 
         hanp_local_planner::ContextCostFunction* context_cost_function_;
+        boost::shared_ptr<pluginlib::ClassLoader<PredictionSource> > prediction_source_loader_;
 
         std::vector<hanp_local_planner::FailureType> failures_;
+
+        // times private stages, see benchmark/scoring_benchmark.cpp
+        friend class ScoringBenchmark;
     };
 };
 #endif
@@ -0,0 +1,107 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HUMAN_PREDICTION_CACHE_H_
+#define HUMAN_PREDICTION_CACHE_H_
+
+#include <atomic>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ros/ros.h>
+#include <hanp_prediction/PredictedPoses.h>
+
+#include <hanp_local_planner/prediction_source.h>
+
+namespace hanp_local_planner {
+
+    // predicted humans as received in one prediction from the prediction source
+    struct PredictionSnapshot
+    {
+        std::vector<hanp_prediction::PredictedPoses> predicted_humans;
+        std::vector<double> predict_times;
+        ros::Time stamp; // time at which the prediction was received
+        bool valid = false;
+
+        ros::Duration age() const { return ros::Time::now() - stamp; }
+    };
+
+    // keeps latest human predictions in two buffers, filled by a background thread,
+    // so that the control thread never waits for the prediction source
+    class HumanPredictionCache
+    {
+    public:
+        HumanPredictionCache();
+        ~HumanPredictionCache();
+
+        void initialize(boost::shared_ptr<PredictionSource> prediction_source);
+
+        // predict_points future poses are requested per human, evenly spaced over predict_time,
+        // after the pose at time 0
+        void setParams(double predict_time, unsigned int predict_points, double prefetch_rate, double max_age);
+
+        // publishes given predictions as if just received, taking over contents of the vectors,
+        // only for use without the prefetch thread
+        void setPredictions(std::vector<hanp_prediction::PredictedPoses>& predicted_humans,
+            std::vector<double>& predict_times);
+
+        // pins the current front buffer for reading, never blocks
+        class Reader
+        {
+        public:
+            Reader(HumanPredictionCache& cache);
+            ~Reader();
+
+            const PredictionSnapshot& operator*() const { return *snapshot_; }
+            const PredictionSnapshot* operator->() const { return snapshot_; }
+
+            // true if snapshot is valid and younger than maximum allowed age
+            bool isFresh() const;
+
+        private:
+            HumanPredictionCache& cache_;
+            int index_;
+            const PredictionSnapshot* snapshot_;
+        };
+
+    private:
+        boost::shared_ptr<PredictionSource> prediction_source_;
+        boost::thread* prefetch_thread_;
+
+        PredictionSnapshot snapshots_[2];
+        std::atomic<int> front_;
+        std::atomic<int> readers_[2];
+
+        std::atomic<unsigned int> predict_points_;
+        std::atomic<double> predict_time_, prefetch_rate_, max_age_;
+
+        void prefetchThread();
+        bool fetch(PredictionSnapshot& snapshot);
+    };
+}
+
+#endif // HUMAN_PREDICTION_CACHE_H_
@@ -0,0 +1,83 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HUMAN_SPATIAL_INDEX_H_
+#define HUMAN_SPATIAL_INDEX_H_
+
+#include <vector>
+#include <cstdint>
+
+namespace hanp_local_planner {
+
+    // uniform grid over the bounding boxes of predicted human paths, rebuilt every
+    // cycle, to find humans that can come close to a trajectory
+    class HumanSpatialIndex
+    {
+    public:
+        HumanSpatialIndex();
+
+        // removes all humans, cells are squares of given size in meters
+        void clear(double cell_size);
+
+        // adds bounding box of the predicted path of a human
+        void insert(unsigned int human, double min_x, double min_y, double max_x, double max_y);
+
+        // must be called after inserting all humans, before querying
+        void build();
+
+        // humans whose boxes overlap given box, each reported once in increasing order
+        void query(double min_x, double min_y, double max_x, double max_y, std::vector<unsigned int>& humans);
+
+        unsigned int size() const { return boxes_.size(); }
+
+    private:
+        struct Entry
+        {
+            int64_t cell;
+            unsigned int human;
+            bool operator<(const Entry& other) const
+            {
+                return cell < other.cell || (cell == other.cell && human < other.human);
+            }
+        };
+        struct Box
+        {
+            double min_x, min_y, max_x, max_y;
+        };
+
+        double cell_size_;
+        std::vector<Entry> entries_;
+        std::vector<Box> boxes_;
+        std::vector<unsigned int> query_marks_;
+        unsigned int query_id_;
+
+        int cellCoord(double coord) const;
+        static int64_t cellKey(int cx, int cy);
+    };
+}
+
+#endif // HUMAN_SPATIAL_INDEX_H_
@@ -0,0 +1,172 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LATENCY_STATS_H_
+#define LATENCY_STATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <ros/ros.h>
+
+namespace hanp_local_planner {
+
+    // log-linear histogram of durations in nanoseconds, about 3% relative error,
+    // recording is lock-free and can run concurrently with collecting
+    class LatencyHistogram
+    {
+    public:
+        struct Summary
+        {
+            uint64_t count, p50, p99, max;
+            double mean;
+        };
+
+        LatencyHistogram();
+
+        void record(uint64_t nsec);
+
+        // summary of recorded durations, optionally starting over
+        Summary collect(bool reset);
+
+    private:
+        static const unsigned int SUB_BUCKET_BITS = 5;
+        static const unsigned int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static const unsigned int BUCKETS = SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1);
+
+        std::atomic<uint64_t> buckets_[BUCKETS];
+        std::atomic<uint64_t> sum_, max_;
+
+        static unsigned int bucketIndex(uint64_t nsec);
+        static uint64_t bucketValue(unsigned int index);
+    };
+
+    // per-stage latencies of control cycles, stages are summed over a cycle and
+    // recorded when it ends, summaries are published on a low rate timer
+    class LatencyStats
+    {
+    public:
+        enum Stage
+        {
+            POSE_LOOKUP = 0,
+            PLAN_TRANSFORM,
+            COST_UPDATE,
+            SEARCH,
+            CONTEXT_SCALING,
+            PUBLISH,
+            CYCLE,
+            N_STAGES
+        };
+
+        // events counted between two published summaries
+        enum Counter
+        {
+            CONTEXT_MEMO_HITS = 0,
+            CONTEXT_MEMO_MISSES,
+            N_COUNTERS
+        };
+
+        typedef std::chrono::steady_clock Clock;
+
+        // times one stage at a time until destroyed
+        class StageTimer
+        {
+        public:
+            StageTimer(LatencyStats& stats, Stage stage);
+            ~StageTimer() { stop(); }
+
+            // ends current stage and starts given one
+            void next(Stage stage);
+            void stop();
+
+        private:
+            LatencyStats& stats_;
+            Stage stage_;
+            bool running_;
+            Clock::time_point start_;
+
+            StageTimer(const StageTimer&);
+            StageTimer& operator=(const StageTimer&);
+        };
+
+        // times a whole cycle, records all its stages when destroyed
+        class CycleTimer
+        {
+        public:
+            CycleTimer(LatencyStats& stats) : stats_(stats) { stats_.beginCycle(); }
+            ~CycleTimer() { stats_.endCycle(); }
+
+        private:
+            LatencyStats& stats_;
+
+            CycleTimer(const CycleTimer&);
+            CycleTimer& operator=(const CycleTimer&);
+        };
+
+        LatencyStats();
+
+        // publishes on ~stats at given rate (disabled if <= 0), and logs stages
+        // of cycles longer than slow_cycle_time seconds (disabled if <= 0)
+        void initialize(ros::NodeHandle& nh, double publish_rate, double slow_cycle_time);
+
+        void addStageTime(Stage stage, Clock::duration duration);
+
+        // summary of recorded cycles of one stage, when not published
+        LatencyHistogram::Summary collect(Stage stage, bool reset) { return histograms_[stage].collect(reset); }
+
+        static const char* stageName(Stage stage);
+
+        void addCount(Counter counter, uint64_t count)
+        {
+            counters_[counter].fetch_add(count, std::memory_order_relaxed);
+        }
+
+        // count since last call, when not published
+        uint64_t collectCount(Counter counter) { return counters_[counter].exchange(0); }
+
+        static const char* counterName(Counter counter);
+
+    private:
+        LatencyHistogram histograms_[N_STAGES];
+        std::atomic<uint64_t> counters_[N_COUNTERS];
+        ros::Publisher stats_pub_;
+        ros::WallTimer stats_timer_;
+        double slow_cycle_time_;
+
+        // only touched by control thread
+        Clock::time_point cycle_start_;
+        Clock::duration cycle_times_[N_STAGES];
+        bool cycle_stages_[N_STAGES];
+
+        void beginCycle();
+        void endCycle();
+        void publishStats(const ros::WallTimerEvent& event);
+    };
+}
+
+#endif // LATENCY_STATS_H_
@@ -0,0 +1,93 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MOTION_PRIMITIVE_LIBRARY_H_
+#define MOTION_PRIMITIVE_LIBRARY_H_
+
+#include <vector>
+#include <Eigen/Core>
+
+#include <base_local_planner/local_planner_limits.h>
+
+#include <hanp_local_planner/velocity_sample_space.h>
+#include <hanp_local_planner/batch_rollout.h>
+
+namespace hanp_local_planner {
+
+    // rollouts of all velocity samples from the origin of the robot frame, for a grid
+    // of discretized current velocities. As the shape of a rollout only depends on the
+    // current velocity and the sample, a cycle only transforms the rollouts of the
+    // nearest current velocity to the robot pose instead of integrating them. Samples the
+    // actual current velocity cannot reach are dropped there, see BatchRollout::transform.
+    class MotionPrimitiveLibrary
+    {
+    public:
+        MotionPrimitiveLibrary();
+
+        // same parameters as VelocitySampleSpace and BatchRollout, resolutions of the current
+        // velocity grid in m/s and rad/s, max_size in MB beyond which the library is not built.
+        // Rebuilds the library only if any of the parameters changed, returns whether it is built.
+        bool build(double sim_time, double sim_period, double sim_granularity, double angular_sim_granularity,
+            bool use_dwa, const base_local_planner::LocalPlannerLimits& limits, const Eigen::Vector3f& vsamples,
+            double trans_resolution, double rot_resolution, double max_size);
+
+        // whether the last build was with the same parameters, so that it would not rebuild
+        bool hasParameters(double sim_time, double sim_period, double sim_granularity,
+            double angular_sim_granularity, bool use_dwa, const base_local_planner::LocalPlannerLimits& limits,
+            const Eigen::Vector3f& vsamples, double trans_resolution, double rot_resolution, double max_size) const;
+
+        void clear();
+
+        bool isBuilt() const { return !primitives_.empty(); }
+
+        // index of the current velocity nearest to vel, -1 if the library does not apply
+        // because the samples would be bounded by the distance to the goal
+        int lookup(const Eigen::Vector3f& pos, const Eigen::Vector3f& vel, const Eigen::Vector3f& goal) const;
+
+        const std::vector<Eigen::Vector3f>& samples(int index) const { return samples_[index]; }
+        const BatchRollout& primitives(int index) const { return primitives_[index]; }
+
+    private:
+        std::vector<double> parameters_;
+
+        static std::vector<double> parameterVector(double sim_time, double sim_period, double sim_granularity,
+            double angular_sim_granularity, bool use_dwa, const base_local_planner::LocalPlannerLimits& limits,
+            const Eigen::Vector3f& vsamples, double trans_resolution, double rot_resolution, double max_size);
+        double sim_time_;
+        bool use_dwa_;
+        float max_vel_x_, max_vel_y_;
+
+        // grid of current velocities
+        Eigen::Vector3f min_vel_, resolution_;
+        Eigen::Vector3i size_;
+
+        std::vector<std::vector<Eigen::Vector3f> > samples_;
+        std::vector<BatchRollout> primitives_;
+    };
+}
+
+#endif // MOTION_PRIMITIVE_LIBRARY_H_
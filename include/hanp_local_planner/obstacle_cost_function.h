@@ -0,0 +1,103 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OBSTACLE_COST_FUNCTION_H_
+#define OBSTACLE_COST_FUNCTION_H_
+
+#include <vector>
+#include <utility>
+
+#include <base_local_planner/trajectory_cost_function.h>
+#include <costmap_2d/costmap_2d.h>
+#include <geometry_msgs/Point.h>
+
+namespace hanp_local_planner {
+
+    // drop-in for base_local_planner::ObstacleCostFunction, checking the footprint perimeter
+    // through cell offsets precomputed for discretized headings and speed scaling levels,
+    // instead of rasterizing the footprint at every trajectory point. The precomputed
+    // perimeter is off from the exact one by up to a margin that grows with the footprint
+    // radius and the heading step, points with a lethal cell within that margin of it are
+    // checked with the exact footprint.
+    class ObstacleCostFunction : public base_local_planner::TrajectoryCostFunction
+    {
+    public:
+        ObstacleCostFunction(costmap_2d::Costmap2D* costmap);
+
+        void setParams(double max_trans_vel, double max_scaling_factor, double scaling_speed);
+
+        // scaling_levels footprint scales between 1 and 1 + max_scaling_factor, with one level
+        // the footprint is not scaled, as base_local_planner::ObstacleCostFunction does
+        void setTableParams(int headings, int scaling_levels);
+
+        // tables are kept for the last few footprints, so that switching back to a footprint
+        // does not rebuild them
+        void setFootprint(const std::vector<geometry_msgs::Point>& footprint_spec);
+
+        void setSumScores(bool score_sums) { sum_scores_ = score_sums; }
+
+        bool prepare();
+        double scoreTrajectory(base_local_planner::Trajectory &traj);
+
+    private:
+        struct CellBounds
+        {
+            int min_x, min_y, max_x, max_y;
+        };
+
+        // perimeter cells of a footprint, and cells within the margin around them, relative
+        // to the cell of the robot, indexed by scaling level * headings + heading
+        struct FootprintTable
+        {
+            std::vector<geometry_msgs::Point> footprint;
+            double resolution;
+            unsigned int size_x;
+            std::vector<std::vector<std::pair<int, int> > > offsets, margin_offsets;
+            std::vector<std::vector<int> > indices, margin_indices;
+            std::vector<CellBounds> bounds; // including the margin
+        };
+
+        costmap_2d::Costmap2D* costmap_;
+        double max_trans_vel_, max_scaling_factor_, scaling_speed_;
+        int headings_, scaling_levels_;
+        bool sum_scores_;
+
+        // most recently set footprint first
+        std::vector<FootprintTable> tables_;
+
+        void buildTable(FootprintTable& table) const;
+        void updateIndices(FootprintTable& table) const;
+        unsigned int scalingLevel(const base_local_planner::Trajectory& traj) const;
+        double levelScale(unsigned int level) const;
+        double footprintCost(const FootprintTable& table, double x, double y, double th, unsigned int level) const;
+        // rasterizes the footprint at the exact pose, as CostmapModel::footprintCost
+        double exactFootprintCost(const FootprintTable& table, double x, double y, double th, unsigned int level,
+            unsigned char center_cost) const;
+    };
+}
+
+#endif // OBSTACLE_COST_FUNCTION_H_
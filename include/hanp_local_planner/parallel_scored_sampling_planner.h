@@ -0,0 +1,119 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PARALLEL_SCORED_SAMPLING_PLANNER_H_
+#define PARALLEL_SCORED_SAMPLING_PLANNER_H_
+
+#include <atomic>
+#include <vector>
+
+#include <base_local_planner/trajectory_search.h>
+#include <base_local_planner/trajectory_cost_function.h>
+
+#include <hanp_local_planner/batch_rollout.h>
+#include <hanp_local_planner/work_stealing_pool.h>
+
+namespace hanp_local_planner {
+
+    // scores the samples of a BatchRollout on a work-stealing thread pool,
+    // returns the same trajectory as base_local_planner::SimpleScoredSamplingPlanner
+    class ParallelScoredSamplingPlanner : public base_local_planner::TrajectorySearch
+    {
+    public:
+        ParallelScoredSamplingPlanner();
+
+        // critics must not modify their state in scoreTrajectory, they are shared by all workers
+        void initialize(BatchRollout* rollout, std::vector<base_local_planner::TrajectoryCostFunction*>& critics,
+            unsigned int threads);
+
+        // with bounded scoring, a trajectory is dropped as soon as its partial cost exceeds the best
+        // cost found, which gives the same best trajectory as long as critics return non-negative costs
+        void setBounded(bool bounded) { bounded_ = bounded; }
+
+        // when no trajectory is valid with critic, the best one with fallback in its place is returned,
+        // fallback costs are only scored for trajectories that critic finds invalid
+        void setFallbackCritic(base_local_planner::TrajectoryCostFunction* critic,
+            base_local_planner::TrajectoryCostFunction* fallback);
+
+        double scoreTrajectory(base_local_planner::Trajectory& traj, double best_traj_cost);
+
+        // if only the critic replaced by the fallback finds traj invalid, fallback_cost is set
+        // to the cost with the fallback in its place, and to -1 otherwise
+        double scoreTrajectory(base_local_planner::Trajectory& traj, double best_traj_cost,
+            double best_fallback_cost, double* fallback_cost);
+
+        // rollout must be done for current cycle
+        bool findBestTrajectory(base_local_planner::Trajectory& traj,
+            std::vector<base_local_planner::Trajectory>* all_explored = 0);
+
+        // seed is the index of a sample scored first to bound all others,
+        // usually the one closest to the best trajectory of the last cycle
+        bool findBestTrajectory(base_local_planner::Trajectory& traj,
+            std::vector<base_local_planner::Trajectory>* all_explored, unsigned int seed);
+
+        // prepares critics once for several calls of scoreAllSamples
+        bool prepare();
+
+        // whether last findBestTrajectory returned a trajectory scored with the fallback critic
+        bool usedFallback() const { return used_fallback_; }
+
+        // exact costs of all samples of the rollout, without bounding by the best cost,
+        // negative for invalid samples, fallback costs as for scoreTrajectory
+        void scoreAllSamples(std::vector<double>& costs, std::vector<double>& fallback_costs);
+
+    private:
+        // state private to each worker
+        struct Worker
+        {
+            base_local_planner::Trajectory loop_traj, best_traj, fallback_traj;
+            double best_cost, fallback_cost;
+            unsigned int best_index, fallback_index;
+        };
+
+        BatchRollout* rollout_;
+        std::vector<base_local_planner::TrajectoryCostFunction*> critics_;
+        base_local_planner::TrajectoryCostFunction *fallback_critic_, *fallback_;
+        bool bounded_, used_fallback_;
+
+        WorkStealingPool pool_;
+        std::vector<Worker> workers_;
+        std::atomic<double> best_cost_bound_, fallback_cost_bound_;
+        // no fallback costs are needed any more once a valid trajectory was found
+        std::atomic<bool> found_valid_;
+
+        std::vector<base_local_planner::Trajectory>* all_explored_;
+        std::vector<char> explored_valid_;
+
+        std::vector<double> *costs_, *fallback_costs_;
+
+        void scoreSamples(unsigned int worker, unsigned int begin, unsigned int end);
+        void scoreSamplesUnbounded(unsigned int worker, unsigned int begin, unsigned int end);
+        void updateBound(std::atomic<double>& bound, double cost);
+    };
+}
+
+#endif // PARALLEL_SCORED_SAMPLING_PLANNER_H_
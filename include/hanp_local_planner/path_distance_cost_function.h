@@ -0,0 +1,76 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PATH_DISTANCE_COST_FUNCTION_H_
+#define PATH_DISTANCE_COST_FUNCTION_H_
+
+#include <base_local_planner/trajectory_cost_function.h>
+#include <costmap_2d/costmap_2d.h>
+
+#include <hanp_local_planner/path_distance_grid.h>
+
+namespace hanp_local_planner {
+
+    // drop-in for base_local_planner::MapGridCostFunction with last-point aggregation,
+    // keeping the distance grid between cycles instead of rebuilding it in prepare
+    class PathDistanceCostFunction : public base_local_planner::TrajectoryCostFunction
+    {
+    public:
+        PathDistanceCostFunction(costmap_2d::Costmap2D* costmap, double xshift = 0.0, double yshift = 0.0,
+            bool is_local_goal_function = false);
+
+        void setTargetPoses(const std::vector<geometry_msgs::PoseStamped>& target_poses);
+
+        void setXShift(double xshift) { xshift_ = xshift; }
+        void setYShift(double yshift) { yshift_ = yshift; }
+        void setStopOnFailure(bool stop_on_failure) { stop_on_failure_ = stop_on_failure; }
+
+        // distances are computed only within radius around given point, whole costmap if radius <= 0
+        void setRegionOfInterest(double center_x, double center_y, double radius);
+
+        bool prepare();
+        double scoreTrajectory(base_local_planner::Trajectory &traj);
+
+        double obstacleCosts() { return grid_.obstacleCosts(); }
+        double unreachableCellCosts() { return grid_.unreachableCellCosts(); }
+        double getCellCosts(unsigned int cx, unsigned int cy) { return grid_.getCellCosts(cx, cy); }
+        void copyCellCosts(std::vector<float>& costs) const
+        {
+            grid_.copyCellCosts(costs, costmap_->getSizeInCellsX(), costmap_->getSizeInCellsY());
+        }
+
+    private:
+        costmap_2d::Costmap2D* costmap_;
+        std::vector<geometry_msgs::PoseStamped> target_poses_;
+        PathDistanceGrid grid_;
+        double xshift_, yshift_;
+        bool stop_on_failure_;
+        double region_center_x_, region_center_y_, region_radius_;
+    };
+}
+
+#endif // PATH_DISTANCE_COST_FUNCTION_H_
@@ -0,0 +1,117 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PATH_DISTANCE_GRID_H_
+#define PATH_DISTANCE_GRID_H_
+
+#include <vector>
+#include <climits>
+
+#include <costmap_2d/costmap_2d.h>
+#include <geometry_msgs/PoseStamped.h>
+
+namespace hanp_local_planner {
+
+    // wavefront distance (in cells, 4-connected) from the global plan, or from the
+    // local goal, same as base_local_planner::MapGrid, but kept between cycles and
+    // repaired only where the plan, the costmap, or the rolling window changed
+    //
+    // distances are only computed in a region of interest of the costmap, plan cells
+    // outside of it seed every free region border cell with their manhattan distance,
+    // and the whole costmap is used when no plan cell can seed the region
+    class PathDistanceGrid
+    {
+    public:
+        PathDistanceGrid(bool is_local_goal_grid = false);
+
+        // brings distances up to date with given costmap and plan, inside the region
+        // of given size in cells starting at given costmap cell
+        void update(const costmap_2d::Costmap2D& costmap, const std::vector<geometry_msgs::PoseStamped>& plan,
+            unsigned int region_x, unsigned int region_y, unsigned int region_size_x, unsigned int region_size_y);
+
+        // same values as MapGrid::operator()(cx, cy).target_dist, unreachable outside the region
+        double getCellCosts(unsigned int map_x, unsigned int map_y) const;
+
+        // getCellCosts of all cells of a costmap of given size, row by row
+        void copyCellCosts(std::vector<float>& costs, unsigned int map_size_x, unsigned int map_size_y) const;
+
+        double obstacleCosts() const { return map_size_; }
+        double unreachableCellCosts() const { return map_size_ + 1; }
+
+        // cells whose distance was recomputed in last update
+        unsigned int updatedCells() const { return updated_cells_; }
+
+    private:
+        static const unsigned int UNREACHED = UINT_MAX;
+        static const unsigned char BLOCKED = 1;
+
+        bool is_local_goal_grid_;
+        unsigned int map_size_;
+        unsigned int region_x_, region_y_, size_x_, size_y_;
+        double resolution_, origin_x_, origin_y_;
+        bool initialized_;
+
+        // distance and seed distance of every cell in the region, seeds are UNREACHED
+        // for cells that are not targets
+        std::vector<unsigned int> dist_, seed_;
+        std::vector<unsigned char> flags_;
+        std::vector<std::pair<unsigned int, unsigned int>> targets_, new_targets_;
+
+        // plan cells in costmap coordinates, and those outside the region in region coordinates
+        std::vector<std::pair<unsigned int, unsigned int>> plan_cells_;
+        std::vector<std::pair<int, int>> outside_cells_;
+
+        // cells to invalidate with their old distance, and cells to recompute
+        std::vector<std::pair<unsigned int, unsigned int>> raise_queue_;
+        std::vector<unsigned int> pull_cells_;
+        std::vector<std::vector<unsigned int>> buckets_;
+        std::vector<unsigned int> shift_dist_, shift_seed_;
+        std::vector<unsigned char> shift_flags_;
+        unsigned int highest_bucket_, updated_cells_;
+
+        void reset(const costmap_2d::Costmap2D& costmap, unsigned int size_x, unsigned int size_y);
+        void shift(int shift_x, int shift_y);
+        void updateBlockedCells(const costmap_2d::Costmap2D& costmap);
+        void updateTargetCells();
+        void findTargetCells(const costmap_2d::Costmap2D& costmap,
+            const std::vector<geometry_msgs::PoseStamped>& plan);
+        bool canSeed(const costmap_2d::Costmap2D& costmap, unsigned int region_x, unsigned int region_y,
+            unsigned int region_size_x, unsigned int region_size_y) const;
+        void findSeedCells();
+
+        bool isExpanding(unsigned int index) const
+        {
+            return !(flags_[index] & BLOCKED) || seed_[index] != UNREACHED;
+        }
+        void invalidate(unsigned int index);
+        void raise(unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y);
+        void lower();
+        void push(unsigned int index, unsigned int dist);
+    };
+}
+
+#endif // PATH_DISTANCE_GRID_H_
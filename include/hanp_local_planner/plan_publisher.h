@@ -0,0 +1,86 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLAN_PUBLISHER_H_
+#define PLAN_PUBLISHER_H_
+
+#include <atomic>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <ros/ros.h>
+#include <nav_msgs/Path.h>
+#include <geometry_msgs/PoseStamped.h>
+
+namespace hanp_local_planner {
+
+    // publishes global and local plans from a background thread, each through a single slot
+    // in which a newer plan replaces one not published yet
+    class PlanPublisher
+    {
+    public:
+        PlanPublisher();
+        ~PlanPublisher();
+
+        void initialize(ros::NodeHandle& nh);
+
+        // global plans are handed off only when changed, at most max_global_rate times per second
+        void setParams(double max_global_rate);
+
+        bool hasLocalPlanSubscribers() const { return local_pub_.getNumSubscribers() > 0; }
+
+        // message to fill by the control thread before publishLocalPlan, poses keep their capacity
+        nav_msgs::Path& localPlan() { return local_back_; }
+        void publishLocalPlan();
+
+        // same message as base_local_planner::publishPlan, empty plans are not published
+        void publishGlobalPlan(const std::vector<geometry_msgs::PoseStamped>& path);
+
+    private:
+        ros::Publisher global_pub_, local_pub_;
+        boost::thread* publish_thread_;
+
+        boost::mutex mutex_;
+        boost::condition_variable queued_;
+
+        // filled by control thread, handed off, and being published
+        nav_msgs::Path local_back_, local_pending_, local_current_;
+        bool local_queued_;
+
+        // last handed off plan is shared with the publishing thread, it is never modified
+        boost::shared_ptr<const nav_msgs::Path> global_last_, global_pending_;
+
+        std::atomic<double> min_global_period_;
+        ros::WallTime last_global_publish_; // only touched by control thread
+
+        bool samePlan(const std::vector<geometry_msgs::PoseStamped>& path) const;
+        void publishThread();
+    };
+}
+
+#endif // PLAN_PUBLISHER_H_
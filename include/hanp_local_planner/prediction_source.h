@@ -0,0 +1,58 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PREDICTION_SOURCE_H_
+#define PREDICTION_SOURCE_H_
+
+#include <string>
+#include <vector>
+
+#include <hanp_prediction/PredictedPoses.h>
+
+namespace hanp_local_planner {
+
+    // source of predicted human poses, loaded as plugin by the planner, predict
+    // is called from the prefetch thread of HumanPredictionCache
+    class PredictionSource
+    {
+    public:
+        virtual ~PredictionSource() {}
+
+        // parameters of the source are read from ~/name
+        virtual void initialize(std::string name) = 0;
+
+        // predicts poses of all humans at the given times in future,
+        // false if no prediction is available
+        virtual bool predict(const std::vector<double>& predict_times,
+            std::vector<hanp_prediction::PredictedPoses>& predicted_humans) = 0;
+
+    protected:
+        PredictionSource() {}
+    };
+}
+
+#endif // PREDICTION_SOURCE_H_
@@ -0,0 +1,55 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SERVICE_PREDICTION_SOURCE_H_
+#define SERVICE_PREDICTION_SOURCE_H_
+
+#include <ros/ros.h>
+#include <hanp_prediction/HumanPosePredict.h>
+
+#include <hanp_local_planner/prediction_source.h>
+
+namespace hanp_local_planner {
+
+    // gets predictions from the human pose prediction service
+    class ServicePredictionSource : public PredictionSource
+    {
+    public:
+        ServicePredictionSource() {}
+
+        void initialize(std::string name);
+        bool predict(const std::vector<double>& predict_times,
+            std::vector<hanp_prediction::PredictedPoses>& predicted_humans);
+
+    private:
+        ros::ServiceClient predict_humans_client_;
+        std::string predict_service_name_;
+        hanp_prediction::HumanPosePredict predict_srv_;
+    };
+}
+
+#endif // SERVICE_PREDICTION_SOURCE_H_
@@ -0,0 +1,85 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRAJECTORY_CLOUD_PUBLISHER_H_
+#define TRAJECTORY_CLOUD_PUBLISHER_H_
+
+#include <atomic>
+#include <vector>
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+#include <pcl_ros/publisher.h>
+#include <base_local_planner/trajectory.h>
+#include <base_local_planner/map_grid_cost_point.h>
+
+namespace hanp_local_planner {
+
+    // publishes explored trajectories as point cloud from a background thread,
+    // the control thread only copies decimated points into a pooled cloud
+    class TrajectoryCloudPublisher
+    {
+    public:
+        TrajectoryCloudPublisher();
+        ~TrajectoryCloudPublisher();
+
+        void initialize(ros::NodeHandle& nh, const std::string& frame_id);
+
+        // every trajectory_decimation-th trajectory and point_decimation-th point of it
+        // are published, at most max_rate times per second
+        void setParams(int trajectory_decimation, int point_decimation, double max_rate);
+
+        // whether a cloud would be published now, so that trajectories are only collected then
+        bool ready() const;
+
+        // never waits for publishing, replaces the oldest queued cloud if no buffer is free
+        void publish(const std::vector<base_local_planner::Trajectory>& trajectories);
+
+    private:
+        typedef pcl::PointCloud<base_local_planner::MapGridCostPoint> Cloud;
+
+        // one being published, up to two queued
+        static const unsigned int BUFFERS = 3;
+
+        pcl_ros::Publisher<base_local_planner::MapGridCostPoint> publisher_;
+        std::string frame_id_;
+        boost::thread* publish_thread_;
+
+        Cloud clouds_[BUFFERS];
+        boost::mutex mutex_;
+        boost::condition_variable queued_;
+        std::vector<Cloud*> free_, queue_;
+
+        std::atomic<int> trajectory_decimation_, point_decimation_;
+        std::atomic<double> min_period_;
+        ros::WallTime last_publish_; // only touched by control thread
+
+        void publishThread();
+    };
+}
+
+#endif // TRAJECTORY_CLOUD_PUBLISHER_H_
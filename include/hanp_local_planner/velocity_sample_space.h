@@ -0,0 +1,73 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef VELOCITY_SAMPLE_SPACE_H_
+#define VELOCITY_SAMPLE_SPACE_H_
+
+#include <vector>
+#include <Eigen/Core>
+
+#include <base_local_planner/local_planner_limits.h>
+
+namespace hanp_local_planner {
+
+    // velocity samples of the SimpleTrajectoryGenerator, made accessible so that
+    // they can be rolled out and scored outside of the generator
+    class VelocitySampleSpace
+    {
+    public:
+        VelocitySampleSpace();
+
+        // same parameters as SimpleTrajectoryGenerator::setParameters
+        void setParameters(double sim_time, double sim_period, bool use_dwa);
+
+        // same sampling as SimpleTrajectoryGenerator::initialise
+        void initialise(const Eigen::Vector3f& pos, const Eigen::Vector3f& vel, const Eigen::Vector3f& goal,
+            const base_local_planner::LocalPlannerLimits& limits, const Eigen::Vector3f& vsamples);
+
+        // replaces samples of the cycle, keeping its feasible velocity space
+        void setSamples(const std::vector<Eigen::Vector3f>& samples) { samples_ = samples; }
+
+        // index of the sample closest to vel, size of samples if there are none
+        unsigned int nearestSample(const Eigen::Vector3f& vel) const;
+
+        const std::vector<Eigen::Vector3f>& samples() const { return samples_; }
+        const Eigen::Vector3f& minVel() const { return min_vel_; }
+        const Eigen::Vector3f& maxVel() const { return max_vel_; }
+        const Eigen::Vector3f& pos() const { return pos_; }
+        const Eigen::Vector3f& vel() const { return vel_; }
+
+    private:
+        double sim_time_, sim_period_;
+        bool use_dwa_;
+
+        Eigen::Vector3f pos_, vel_, min_vel_, max_vel_;
+        std::vector<Eigen::Vector3f> samples_;
+    };
+}
+
+#endif // VELOCITY_SAMPLE_SPACE_H_
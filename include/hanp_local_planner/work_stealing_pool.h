@@ -0,0 +1,86 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WORK_STEALING_POOL_H_
+#define WORK_STEALING_POOL_H_
+
+#include <deque>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace hanp_local_planner {
+
+    // fixed set of worker threads that run index ranges of a loop, idle workers
+    // steal ranges from the back of other workers' queues
+    class WorkStealingPool
+    {
+    public:
+        // task(worker, begin, end) processes indices [begin, end)
+        typedef boost::function<void (unsigned int, unsigned int, unsigned int)> RangeTask;
+
+        WorkStealingPool();
+        ~WorkStealingPool();
+
+        // number of workers, including the calling thread
+        void resize(unsigned int workers);
+        unsigned int size() const { return queues_.size(); }
+
+        // runs task over [0, count) in ranges of grain indices, returns when all are done
+        void parallelFor(unsigned int count, unsigned int grain, const RangeTask& task);
+
+    private:
+        struct Range
+        {
+            unsigned int begin, end;
+        };
+        struct RangeQueue
+        {
+            boost::mutex mutex;
+            std::deque<Range> ranges;
+        };
+
+        std::vector<boost::shared_ptr<RangeQueue> > queues_;
+        boost::thread_group threads_;
+
+        boost::mutex job_mutex_;
+        boost::condition_variable job_cond_, done_cond_;
+        const RangeTask* task_;
+        unsigned long job_id_;
+        unsigned int busy_workers_;
+        bool stop_;
+
+        void workerThread(unsigned int worker);
+        void runRanges(unsigned int worker);
+        bool popRange(unsigned int worker, Range& range);
+        bool stealRange(unsigned int worker, Range& range);
+        void stopThreads();
+    };
+}
+
+#endif // WORK_STEALING_POOL_H_
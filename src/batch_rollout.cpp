@@ -0,0 +1,263 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/batch_rollout.h>
+
+#include <cmath>
+#include <algorithm>
+
+namespace hanp_local_planner
+{
+    BatchRollout::BatchRollout() : sim_time_(0.0), sim_granularity_(0.0), angular_sim_granularity_(0.0),
+        continued_acceleration_(false) {}
+
+    void BatchRollout::setParameters(double sim_time, double sim_granularity, double angular_sim_granularity,
+        bool use_dwa)
+    {
+        sim_time_ = sim_time;
+        sim_granularity_ = sim_granularity;
+        angular_sim_granularity_ = angular_sim_granularity;
+        continued_acceleration_ = !use_dwa;
+    }
+
+    void BatchRollout::rollout(const VelocitySampleSpace& sample_space,
+        const base_local_planner::LocalPlannerLimits& limits)
+    {
+        const auto& samples = sample_space.samples();
+        unsigned int n = samples.size();
+        num_steps_.resize(n);
+        resizeLanes(n);
+
+        unsigned int max_steps = 0;
+        for(unsigned int i = 0; i < n; ++i)
+        {
+            const auto& sample = samples[i];
+            target_x_[i] = sample[0];
+            target_y_[i] = sample[1];
+            target_th_[i] = sample[2];
+            num_steps_[i] = numSteps(sample, limits);
+            dt_[i] = num_steps_[i] > 0 ? sim_time_ / num_steps_[i] : 0.0;
+            max_steps = std::max(max_steps, num_steps_[i]);
+        }
+
+        // buffers only grow, so that steady state needs no allocation
+        if((unsigned int)x_.cols() != n || (unsigned int)x_.rows() < max_steps)
+        {
+            unsigned int rows = std::max((unsigned int)x_.rows(), max_steps);
+            x_.resize(rows, n);
+            y_.resize(rows, n);
+            th_.resize(rows, n);
+        }
+
+        Eigen::Vector3f acc_lim = limits.getAccLimits();
+        acc_dt_x_ = dt_ * acc_lim[0];
+        acc_dt_y_ = dt_ * acc_lim[1];
+        acc_dt_th_ = dt_ * acc_lim[2];
+
+        const auto& pos = sample_space.pos();
+        const auto& vel = sample_space.vel();
+        pos_x_.setConstant(pos[0]);
+        pos_y_.setConstant(pos[1]);
+        pos_th_.setConstant(pos[2]);
+        if(continued_acceleration_)
+        {
+            vel_x_.setConstant(vel[0]);
+            vel_y_.setConstant(vel[1]);
+            vel_th_.setConstant(vel[2]);
+            computeNewVelocities();
+        }
+        else
+        {
+            vel_x_ = target_x_;
+            vel_y_ = target_y_;
+            vel_th_ = target_th_;
+        }
+        // commanded velocity is the first ramped step, as SimpleTrajectoryGenerator does for theta
+        xv_ = vel_x_;
+        yv_ = vel_y_;
+        thetav_ = vel_th_;
+
+        // samples with fewer steps are integrated along, their extra rows are never read
+        for(unsigned int k = 0; k < max_steps; ++k)
+        {
+            x_.row(k) = pos_x_;
+            y_.row(k) = pos_y_;
+            th_.row(k) = pos_th_;
+
+            if(continued_acceleration_)
+            {
+                computeNewVelocities();
+            }
+
+            // same as SimpleTrajectoryGenerator::computeNewPositions, with cos(pi/2 + th) = -sin(th)
+            cos_th_ = pos_th_.cos();
+            sin_th_ = pos_th_.sin();
+            pos_x_ += (vel_x_ * cos_th_ - vel_y_ * sin_th_) * dt_;
+            pos_y_ += (vel_x_ * sin_th_ + vel_y_ * cos_th_) * dt_;
+            pos_th_ += vel_th_ * dt_;
+        }
+    }
+
+    unsigned int BatchRollout::maxSteps(const VelocitySampleSpace& sample_space,
+        const base_local_planner::LocalPlannerLimits& limits) const
+    {
+        unsigned int max_steps = 0;
+        for(const auto& sample : sample_space.samples())
+        {
+            max_steps = std::max(max_steps, numSteps(sample, limits));
+        }
+        return max_steps;
+    }
+
+    unsigned int BatchRollout::numSteps(const Eigen::Vector3f& sample,
+        const base_local_planner::LocalPlannerLimits& limits) const
+    {
+        // as in SimpleTrajectoryGenerator::generateTrajectory
+        double eps = 1e-4;
+        double vmag = hypot(sample[0], sample[1]);
+        if((limits.min_trans_vel >= 0 && vmag + eps < limits.min_trans_vel) &&
+            (limits.min_rot_vel >= 0 && fabs(sample[2]) + eps < limits.min_rot_vel))
+        {
+            return 0;
+        }
+        if(limits.max_trans_vel >= 0 && vmag - eps > limits.max_trans_vel)
+        {
+            return 0;
+        }
+
+        double sim_time_distance = vmag * sim_time_;
+        double sim_time_angle = fabs(sample[2]) * sim_time_;
+        return ceil(std::max(sim_time_distance / sim_granularity_, sim_time_angle / angular_sim_granularity_));
+    }
+
+    void BatchRollout::resizeLanes(unsigned int n)
+    {
+        if(target_x_.size() != n)
+        {
+            target_x_.resize(n); target_y_.resize(n); target_th_.resize(n);
+            xv_.resize(n); yv_.resize(n); thetav_.resize(n); dt_.resize(n);
+            vel_x_.resize(n); vel_y_.resize(n); vel_th_.resize(n);
+            pos_x_.resize(n); pos_y_.resize(n); pos_th_.resize(n);
+            cos_th_.resize(n); sin_th_.resize(n);
+            acc_dt_x_.resize(n); acc_dt_y_.resize(n); acc_dt_th_.resize(n);
+        }
+    }
+
+    void BatchRollout::transform(const BatchRollout& primitives, const VelocitySampleSpace& sample_space,
+        const base_local_planner::LocalPlannerLimits& limits)
+    {
+        num_steps_ = primitives.num_steps_;
+        resizeLanes(num_steps_.size());
+        target_x_ = primitives.target_x_;
+        target_y_ = primitives.target_y_;
+        target_th_ = primitives.target_th_;
+        dt_ = primitives.dt_;
+
+        // primitives were sampled around the nearest velocity of the library, samples that
+        // the current velocity cannot reach are never scored
+        double eps = 1e-4;
+        const auto& min_vel = sample_space.minVel();
+        const auto& max_vel = sample_space.maxVel();
+        for(unsigned int i = 0; i < num_steps_.size(); ++i)
+        {
+            if(target_x_[i] < min_vel[0] - eps || target_x_[i] > max_vel[0] + eps ||
+                target_y_[i] < min_vel[1] - eps || target_y_[i] > max_vel[1] + eps ||
+                target_th_[i] < min_vel[2] - eps || target_th_[i] > max_vel[2] + eps)
+            {
+                num_steps_[i] = 0;
+            }
+        }
+
+        // commanded velocity is the first step ramped up from the current velocity, as in rollout
+        const auto& vel = sample_space.vel();
+        if(continued_acceleration_)
+        {
+            Eigen::Vector3f acc_lim = limits.getAccLimits();
+            acc_dt_x_ = dt_ * acc_lim[0];
+            acc_dt_y_ = dt_ * acc_lim[1];
+            acc_dt_th_ = dt_ * acc_lim[2];
+            vel_x_.setConstant(vel[0]);
+            vel_y_.setConstant(vel[1]);
+            vel_th_.setConstant(vel[2]);
+            computeNewVelocities();
+            xv_ = vel_x_;
+            yv_ = vel_y_;
+            thetav_ = vel_th_;
+        }
+        else
+        {
+            xv_ = target_x_;
+            yv_ = target_y_;
+            thetav_ = target_th_;
+        }
+
+        const auto& pos = sample_space.pos();
+        unsigned int n = primitives.x_.cols();
+        unsigned int steps = primitives.x_.rows();
+        if((unsigned int)x_.cols() != n || (unsigned int)x_.rows() < steps)
+        {
+            unsigned int rows = std::max((unsigned int)x_.rows(), steps);
+            x_.resize(rows, n);
+            y_.resize(rows, n);
+            th_.resize(rows, n);
+        }
+
+        float cos_th = cos(pos[2]);
+        float sin_th = sin(pos[2]);
+        x_.topRows(steps) = pos[0] + cos_th * primitives.x_ - sin_th * primitives.y_;
+        y_.topRows(steps) = pos[1] + sin_th * primitives.x_ + cos_th * primitives.y_;
+        th_.topRows(steps) = pos[2] + primitives.th_;
+    }
+
+    void BatchRollout::computeNewVelocities()
+    {
+        vel_x_ = (target_x_ < vel_x_).select((vel_x_ - acc_dt_x_).max(target_x_), (vel_x_ + acc_dt_x_).min(target_x_));
+        vel_y_ = (target_y_ < vel_y_).select((vel_y_ - acc_dt_y_).max(target_y_), (vel_y_ + acc_dt_y_).min(target_y_));
+        vel_th_ = (target_th_ < vel_th_).select((vel_th_ - acc_dt_th_).max(target_th_),
+            (vel_th_ + acc_dt_th_).min(target_th_));
+    }
+
+    bool BatchRollout::getTrajectory(unsigned int sample, base_local_planner::Trajectory& traj) const
+    {
+        traj.cost_ = -1.0;
+        traj.resetPoints();
+        if(num_steps_[sample] == 0)
+        {
+            return false;
+        }
+
+        traj.xv_ = xv_[sample];
+        traj.yv_ = yv_[sample];
+        traj.thetav_ = thetav_[sample];
+        traj.time_delta_ = dt_[sample];
+        for(unsigned int k = 0; k < num_steps_[sample]; ++k)
+        {
+            traj.addPoint(x_(k, sample), y_(k, sample), th_(k, sample));
+        }
+        return true;
+    }
+}
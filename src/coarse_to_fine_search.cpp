@@ -0,0 +1,225 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/coarse_to_fine_search.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <ros/ros.h>
+
+#define VEL_EPS 1e-4 // tolerance for velocities on the bounds of the sample space
+
+namespace hanp_local_planner
+{
+    CoarseToFineSearch::CoarseToFineSearch() : sample_space_(NULL), rollout_(NULL), planner_(NULL),
+        refine_radius_(1), top_k_(3), levels_(2), used_fallback_(false) {}
+
+    void CoarseToFineSearch::initialize(VelocitySampleSpace* sample_space, BatchRollout* rollout,
+        ParallelScoredSamplingPlanner* planner)
+    {
+        sample_space_ = sample_space;
+        rollout_ = rollout;
+        planner_ = planner;
+    }
+
+    void CoarseToFineSearch::setParameters(int refine_samples, int top_k, int levels)
+    {
+        refine_radius_ = std::max(1, refine_samples / 2);
+        top_k_ = std::max(1, top_k);
+        levels_ = std::max(0, levels);
+    }
+
+    bool CoarseToFineSearch::findBestTrajectory(const base_local_planner::LocalPlannerLimits& limits,
+        base_local_planner::Trajectory& traj, std::vector<base_local_planner::Trajectory>* all_explored)
+    {
+        if(!planner_->prepare())
+        {
+            return false;
+        }
+
+        const Eigen::Vector3f& min_vel = sample_space_->minVel();
+        const Eigen::Vector3f& max_vel = sample_space_->maxVel();
+
+        // spacing of the coarse grid, VelocityIterator only adds zero between two samples
+        Eigen::Vector3f spacing = Eigen::Vector3f::Zero();
+        std::vector<float> values;
+        for(unsigned int d = 0; d < 3; ++d)
+        {
+            values.clear();
+            for(const auto& sample : sample_space_->samples())
+            {
+                values.push_back(sample[d]);
+            }
+            std::sort(values.begin(), values.end());
+            for(unsigned int i = 1; i < values.size(); ++i)
+            {
+                spacing[d] = std::max(spacing[d], values[i] - values[i - 1]);
+            }
+        }
+
+        candidates_.clear();
+        level_.clear();
+        for(const auto& sample : sample_space_->samples())
+        {
+            level_.push_back(Candidate{sample, spacing, -1.0, false});
+        }
+        if(all_explored)
+        {
+            all_explored->clear();
+        }
+
+        best_traj_.cost_ = -1.0;
+        fallback_traj_.cost_ = -1.0;
+        scoreLevel(limits, all_explored);
+
+        for(int level = 0; level < levels_; ++level)
+        {
+            // best valid velocities found so far, those only valid with the fallback critic last,
+            // ties resolved by order of scoring
+            order_.clear();
+            for(unsigned int i = 0; i < candidates_.size(); ++i)
+            {
+                if(candidates_[i].cost >= 0 && !candidates_[i].spacing.isZero())
+                {
+                    order_.push_back(i);
+                }
+            }
+            unsigned int k = std::min<unsigned int>(top_k_, order_.size());
+            std::partial_sort(order_.begin(), order_.begin() + k, order_.end(),
+                [this](unsigned int a, unsigned int b)
+                {
+                    const Candidate& ca = candidates_[a];
+                    const Candidate& cb = candidates_[b];
+                    return ca.fallback < cb.fallback || (ca.fallback == cb.fallback &&
+                        (ca.cost < cb.cost || (ca.cost == cb.cost && a < b)));
+                });
+
+            for(unsigned int i = 0; i < k; ++i)
+            {
+                // finer grid centred on the candidate, with its neighbours of the coarser grid as bounds
+                Candidate& centre = candidates_[order_[i]];
+                centre.spacing /= refine_radius_ + 1;
+                Eigen::Vector3f vel;
+                for(int jx = -refine_radius_; jx <= refine_radius_; ++jx)
+                {
+                    vel[0] = centre.vel[0] + jx * centre.spacing[0];
+                    for(int jy = -refine_radius_; jy <= refine_radius_; ++jy)
+                    {
+                        vel[1] = centre.vel[1] + jy * centre.spacing[1];
+                        for(int jth = -refine_radius_; jth <= refine_radius_; ++jth)
+                        {
+                            vel[2] = centre.vel[2] + jth * centre.spacing[2];
+                            if(((vel - min_vel).array() < -VEL_EPS).any() || ((vel - max_vel).array() > VEL_EPS).any()
+                                || isSampled(vel, centre.spacing))
+                            {
+                                continue;
+                            }
+                            level_.push_back(Candidate{vel, centre.spacing, -1.0, false});
+                        }
+                    }
+                }
+            }
+
+            if(level_.empty())
+            {
+                break;
+            }
+            scoreLevel(limits, all_explored);
+        }
+
+        used_fallback_ = best_traj_.cost_ < 0 && fallback_traj_.cost_ >= 0;
+        if(used_fallback_)
+        {
+            std::swap(best_traj_, fallback_traj_);
+        }
+        if(best_traj_.cost_ < 0)
+        {
+            ROS_DEBUG("Evaluated %lu trajectories, found no valid one", candidates_.size());
+            return false;
+        }
+
+        traj = best_traj_;
+        ROS_DEBUG("Evaluated %lu trajectories, best cost %f (%f, %f, %f)", candidates_.size(),
+            traj.cost_, traj.xv_, traj.yv_, traj.thetav_);
+        return true;
+    }
+
+    void CoarseToFineSearch::scoreLevel(const base_local_planner::LocalPlannerLimits& limits,
+        std::vector<base_local_planner::Trajectory>* all_explored)
+    {
+        samples_.clear();
+        for(const auto& candidate : level_)
+        {
+            samples_.push_back(candidate.vel);
+        }
+        sample_space_->setSamples(samples_);
+        rollout_->rollout(*sample_space_, limits);
+        planner_->scoreAllSamples(costs_, fallback_costs_);
+
+        for(unsigned int i = 0; i < level_.size(); ++i)
+        {
+            level_[i].fallback = costs_[i] < 0 && fallback_costs_[i] >= 0;
+            level_[i].cost = level_[i].fallback ? fallback_costs_[i] : costs_[i];
+            if(!rollout_->getTrajectory(i, loop_traj_))
+            {
+                continue;
+            }
+            loop_traj_.cost_ = costs_[i];
+            if(all_explored)
+            {
+                all_explored->push_back(loop_traj_);
+            }
+            base_local_planner::Trajectory& best = level_[i].fallback ? fallback_traj_ : best_traj_;
+            if(level_[i].cost >= 0 && (best.cost_ < 0 || level_[i].cost < best.cost_))
+            {
+                best = loop_traj_;
+                best.cost_ = level_[i].cost;
+            }
+        }
+
+        candidates_.insert(candidates_.end(), level_.begin(), level_.end());
+        level_.clear();
+    }
+
+    bool CoarseToFineSearch::isSampled(const Eigen::Vector3f& vel, const Eigen::Vector3f& spacing) const
+    {
+        // closer than half the spacing of the new grid counts as the same velocity
+        Eigen::Array3f tolerance = (spacing.array() * 0.5f).max(float(VEL_EPS));
+        for(const auto* scored : {&candidates_, &level_})
+        {
+            for(const auto& candidate : *scored)
+            {
+                if(((candidate.vel - vel).array().abs() < tolerance).all())
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}
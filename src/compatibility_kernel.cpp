@@ -0,0 +1,291 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define SIMD_WIDTH 8 // floats per AVX2 register
+
+#include <hanp_local_planner/compatibility_kernel.h>
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace hanp_local_planner
+{
+    constexpr float CompatibilityKernel::ATAN2_MAX_ERROR;
+
+    namespace
+    {
+        const float PI_F = M_PI;
+        const float PI_2_F = M_PI_2;
+        const float TWO_PI_F = 2.0 * M_PI;
+        const float INV_TWO_PI_F = 0.5 / M_PI;
+
+        // minimax polynomial for atan(a) / a on [0, 1], in a^2
+        const float ATAN_C0 = 0.99997726f;
+        const float ATAN_C1 = -0.33262347f;
+        const float ATAN_C2 = 0.19354346f;
+        const float ATAN_C3 = -0.11643287f;
+        const float ATAN_C4 = 0.05265332f;
+        const float ATAN_C5 = -0.01172120f;
+
+        // angle in [-pi, pi]
+        inline float wrapAngle(float angle)
+        {
+            return angle - TWO_PI_F * rintf(angle * INV_TWO_PI_F);
+        }
+    }
+
+    CompatibilityKernel::CompatibilityKernel() : alpha_max_(0.0), d_low_(0.0), d_high_(0.0), cos_beta_(1.0),
+        origin_x_(0.0), origin_y_(0.0), points_(0), stride_(0), humans_(0), use_avx2_(false)
+    {
+#ifdef HAVE_AVX2_KERNEL
+        use_avx2_ = __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    void CompatibilityKernel::setParams(double alpha_max, double d_low, double d_high, double beta)
+    {
+        alpha_max_ = alpha_max;
+        d_low_ = d_low;
+        d_high_ = d_high;
+        cos_beta_ = cos(beta);
+    }
+
+    float CompatibilityKernel::fastAtan2(float y, float x)
+    {
+        float ax = fabsf(x), ay = fabsf(y);
+        float mx = std::max(ax, ay), mn = std::min(ax, ay);
+        float a = mx > 0.0f ? mn / mx : 0.0f;
+        float s = a * a;
+        float r = a * (ATAN_C0 + s * (ATAN_C1 + s * (ATAN_C2 + s * (ATAN_C3 + s * (ATAN_C4 + s * ATAN_C5)))));
+        if(ay > ax)
+        {
+            r = PI_2_F - r;
+        }
+        if(x < 0.0f)
+        {
+            r = PI_F - r;
+        }
+        return y < 0.0f ? -r : r;
+    }
+
+    void CompatibilityKernel::reset(unsigned int points, double origin_x, double origin_y)
+    {
+        origin_x_ = origin_x;
+        origin_y_ = origin_y;
+        points_ = points;
+        stride_ = (points + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+        humans_ = 0;
+
+        // resize keeps capacity, nothing is allocated once the largest trajectory was seen
+        rx_.resize(stride_, 0.0f);
+        ry_.resize(stride_, 0.0f);
+        rth_.resize(stride_, 0.0f);
+        rcos_.resize(stride_, 1.0f);
+        rsin_.resize(stride_, 0.0f);
+    }
+
+    void CompatibilityKernel::setRobotPose(unsigned int point, double x, double y, double theta)
+    {
+        // subtract in double precision, so float rounding depends on the offset only
+        rx_[point] = x - origin_x_;
+        ry_[point] = y - origin_y_;
+        rth_[point] = theta;
+        rcos_[point] = cos(theta);
+        rsin_[point] = sin(theta);
+    }
+
+    unsigned int CompatibilityKernel::addHuman()
+    {
+        auto human = humans_++;
+        auto size = humans_ * stride_;
+        hx_.resize(size, 0.0f);
+        hy_.resize(size, 0.0f);
+        hqx_.resize(size, 0.0f);
+        hqy_.resize(size, 0.0f);
+        hqz_.resize(size, 0.0f);
+        hqw_.resize(size, 1.0f);
+        hr_.resize(size, 0.0f);
+        return human;
+    }
+
+    void CompatibilityKernel::setHumanPose(unsigned int human, unsigned int point, double x, double y,
+        double qx, double qy, double qz, double qw, double radius)
+    {
+        auto i = human * stride_ + point;
+        hx_[i] = x - origin_x_;
+        hy_[i] = y - origin_y_;
+        hqx_[i] = qx;
+        hqy_[i] = qy;
+        hqz_[i] = qz;
+        hqw_[i] = qw;
+        hr_[i] = radius;
+    }
+
+    unsigned int CompatibilityKernel::pointIndexMax(unsigned int limit) const
+    {
+        limit = std::min(limit, points_);
+        for(unsigned int human = 0; human < humans_ && limit > 1; ++human)
+        {
+            auto incompatible = firstIncompatible(human, limit);
+            if(incompatible < limit)
+            {
+                limit = incompatible + 1;
+            }
+        }
+        return limit;
+    }
+
+    unsigned int CompatibilityKernel::firstIncompatible(unsigned int human, unsigned int end) const
+    {
+#ifdef HAVE_AVX2_KERNEL
+        if(use_avx2_)
+        {
+            return firstIncompatibleAVX2(human, end);
+        }
+#endif
+        return firstIncompatibleScalar(human, 0, end);
+    }
+
+    unsigned int CompatibilityKernel::firstIncompatibleScalar(unsigned int human, unsigned int begin,
+        unsigned int end) const
+    {
+        const auto row = human * stride_;
+        for(unsigned int i = begin; i < end; ++i)
+        {
+            float dx = rx_[i] - hx_[row + i];
+            float dy = ry_[i] - hy_[row + i];
+            float dist = sqrtf(dx * dx + dy * dy);
+
+            // discard human behind the robot
+            if(dx * rcos_[i] + dy * rsin_[i] > cos_beta_ * dist)
+            {
+                continue;
+            }
+
+            float d_p = dist - hr_[row + i];
+            if(d_p <= d_low_)
+            {
+                return i;
+            }
+
+            float qx = hqx_[row + i], qy = hqy_[row + i], qz = hqz_[row + i], qw = hqw_[row + i];
+            float human_yaw = fastAtan2(2.0f * (qw * qz + qx * qy), 1.0f - 2.0f * (qy * qy + qz * qz));
+            float alpha = fabsf(wrapAngle(human_yaw + PI_F - rth_[i]));
+            if(d_p < d_high_ && alpha < alpha_max_ && alpha <= ATAN2_MAX_ERROR)
+            {
+                return i;
+            }
+        }
+        return end;
+    }
+
+#ifdef HAVE_AVX2_KERNEL
+    __attribute__((target("avx2")))
+    unsigned int CompatibilityKernel::firstIncompatibleAVX2(unsigned int human, unsigned int end) const
+    {
+        const auto row = human * stride_;
+        const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        const __m256 pi = _mm256_set1_ps(PI_F);
+        const __m256 pi_2 = _mm256_set1_ps(PI_2_F);
+        const __m256 two_pi = _mm256_set1_ps(TWO_PI_F);
+        const __m256 inv_two_pi = _mm256_set1_ps(INV_TWO_PI_F);
+        const __m256 cos_beta = _mm256_set1_ps(cos_beta_);
+        const __m256 d_low = _mm256_set1_ps(d_low_);
+        const __m256 d_high = _mm256_set1_ps(d_high_);
+        const __m256 alpha_max = _mm256_set1_ps(alpha_max_);
+        const __m256 alpha_eps = _mm256_set1_ps(ATAN2_MAX_ERROR);
+
+        unsigned int i = 0;
+        for(; i + SIMD_WIDTH <= end; i += SIMD_WIDTH)
+        {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&rx_[i]), _mm256_loadu_ps(&hx_[row + i]));
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&ry_[i]), _mm256_loadu_ps(&hy_[row + i]));
+            __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+
+            __m256 front = _mm256_add_ps(_mm256_mul_ps(dx, _mm256_loadu_ps(&rcos_[i])),
+                _mm256_mul_ps(dy, _mm256_loadu_ps(&rsin_[i])));
+            __m256 behind = _mm256_cmp_ps(front, _mm256_mul_ps(cos_beta, dist), _CMP_GT_OQ);
+
+            __m256 d_p = _mm256_sub_ps(dist, _mm256_loadu_ps(&hr_[row + i]));
+            __m256 close = _mm256_cmp_ps(d_p, d_low, _CMP_LE_OQ);
+
+            // human yaw from quaternion, with fastAtan2 evaluated on 8 lanes
+            __m256 qx = _mm256_loadu_ps(&hqx_[row + i]);
+            __m256 qy = _mm256_loadu_ps(&hqy_[row + i]);
+            __m256 qz = _mm256_loadu_ps(&hqz_[row + i]);
+            __m256 qw = _mm256_loadu_ps(&hqw_[row + i]);
+            __m256 y = _mm256_mul_ps(two, _mm256_add_ps(_mm256_mul_ps(qw, qz), _mm256_mul_ps(qx, qy)));
+            __m256 x = _mm256_sub_ps(one, _mm256_mul_ps(two,
+                _mm256_add_ps(_mm256_mul_ps(qy, qy), _mm256_mul_ps(qz, qz))));
+
+            __m256 ax = _mm256_and_ps(x, abs_mask);
+            __m256 ay = _mm256_and_ps(y, abs_mask);
+            __m256 mx = _mm256_max_ps(ax, ay);
+            __m256 a = _mm256_and_ps(_mm256_div_ps(_mm256_min_ps(ax, ay), mx), _mm256_cmp_ps(mx, zero, _CMP_GT_OQ));
+            __m256 s = _mm256_mul_ps(a, a);
+            __m256 p = _mm256_set1_ps(ATAN_C5);
+            p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_C4));
+            p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_C3));
+            p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_C2));
+            p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_C1));
+            p = _mm256_add_ps(_mm256_mul_ps(p, s), _mm256_set1_ps(ATAN_C0));
+            __m256 yaw = _mm256_mul_ps(p, a);
+            yaw = _mm256_blendv_ps(yaw, _mm256_sub_ps(pi_2, yaw), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+            yaw = _mm256_blendv_ps(yaw, _mm256_sub_ps(pi, yaw), _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+            yaw = _mm256_or_ps(yaw, _mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_LT_OQ), sign_mask));
+
+            __m256 alpha = _mm256_sub_ps(_mm256_add_ps(yaw, pi), _mm256_loadu_ps(&rth_[i]));
+            alpha = _mm256_sub_ps(alpha, _mm256_mul_ps(two_pi, _mm256_round_ps(_mm256_mul_ps(alpha, inv_two_pi),
+                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)));
+            alpha = _mm256_and_ps(alpha, abs_mask);
+            __m256 head_on = _mm256_and_ps(_mm256_cmp_ps(d_p, d_high, _CMP_LT_OQ),
+                _mm256_and_ps(_mm256_cmp_ps(alpha, alpha_max, _CMP_LT_OQ), _mm256_cmp_ps(alpha, alpha_eps, _CMP_LE_OQ)));
+
+            int incompatible = _mm256_movemask_ps(_mm256_andnot_ps(behind, _mm256_or_ps(close, head_on)));
+            if(incompatible)
+            {
+                return i + __builtin_ctz(incompatible);
+            }
+        }
+        return firstIncompatibleScalar(human, i, end);
+    }
+#else
+    unsigned int CompatibilityKernel::firstIncompatibleAVX2(unsigned int human, unsigned int end) const
+    {
+        return firstIncompatibleScalar(human, 0, end);
+    }
+#endif
+}
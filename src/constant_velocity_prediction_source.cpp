@@ -0,0 +1,137 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define TRACKED_HUMANS_TOPIC "/tracked_humans"
+#define HUMAN_RADIUS 0.25 // meters
+#define VELOBS_MUL 1.0 // meters of radius growth per meter travelled
+#define VELOBS_MAX_RADIUS 1.5 // meters, maximum radius of a predicted human
+
+#include <hanp_local_planner/constant_velocity_prediction_source.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <hanp_msgs/TrackedSegmentType.h>
+#include <pluginlib/class_list_macros.h>
+
+PLUGINLIB_EXPORT_CLASS(hanp_local_planner::ConstantVelocityPredictionSource, hanp_local_planner::PredictionSource)
+
+namespace hanp_local_planner
+{
+    ConstantVelocityPredictionSource::ConstantVelocityPredictionSource() : human_radius_(HUMAN_RADIUS),
+        velobs_mul_(VELOBS_MUL), velobs_max_radius_(VELOBS_MAX_RADIUS), velocity_obstacle_(true) {}
+
+    void ConstantVelocityPredictionSource::initialize(std::string name)
+    {
+        ros::NodeHandle private_nh("~/" + name);
+        std::string tracked_humans_topic;
+        private_nh.param<std::string>("tracked_humans_topic", tracked_humans_topic, TRACKED_HUMANS_TOPIC);
+        private_nh.param("human_radius", human_radius_, HUMAN_RADIUS);
+        private_nh.param("velocity_obstacle", velocity_obstacle_, true);
+        private_nh.param("velobs_mul", velobs_mul_, VELOBS_MUL);
+        private_nh.param("velobs_max_radius", velobs_max_radius_, VELOBS_MAX_RADIUS);
+
+        tracked_humans_sub_ = private_nh.subscribe(tracked_humans_topic, 1,
+            &ConstantVelocityPredictionSource::trackedHumansCB, this);
+
+        ROS_INFO_NAMED("constant_velocity_prediction_source", "predicting humans from %s topic with %s",
+            tracked_humans_topic.c_str(), velocity_obstacle_ ? "velocity obstacles" : "constant velocity");
+    }
+
+    void ConstantVelocityPredictionSource::trackedHumansCB(const hanp_msgs::TrackedHumans::ConstPtr& tracked_humans)
+    {
+        boost::mutex::scoped_lock l(tracked_humans_mutex_);
+        tracked_humans_ = tracked_humans;
+    }
+
+    bool ConstantVelocityPredictionSource::predict(const std::vector<double>& predict_times,
+        std::vector<hanp_prediction::PredictedPoses>& predicted_humans)
+    {
+        hanp_msgs::TrackedHumans::ConstPtr tracked_humans;
+        {
+            boost::mutex::scoped_lock l(tracked_humans_mutex_);
+            tracked_humans = tracked_humans_;
+        }
+        if(!tracked_humans)
+        {
+            return false;
+        }
+
+        // predict times are from now, humans were tracked a bit earlier
+        double age = std::max(0.0, (ros::Time::now() - tracked_humans->header.stamp).toSec());
+
+        predicted_humans.resize(tracked_humans->humans.size());
+        unsigned int human_count = 0;
+        for(const auto& tracked_human : tracked_humans->humans)
+        {
+            if(tracked_human.segments.empty())
+            {
+                continue;
+            }
+
+            // torso moves most steadily, otherwise take any segment
+            auto segment = std::find_if(tracked_human.segments.begin(), tracked_human.segments.end(),
+                [](const hanp_msgs::TrackedSegment& segment)
+                { return segment.type == hanp_msgs::TrackedSegmentType::TORSO; });
+            if(segment == tracked_human.segments.end())
+            {
+                segment = tracked_human.segments.begin();
+            }
+
+            const auto& position = segment->pose.pose.position;
+            const auto& velocity = segment->twist.twist.linear;
+            double speed = hypot(velocity.x, velocity.y);
+
+            auto& predicted_human = predicted_humans[human_count++];
+            predicted_human.id = tracked_human.track_id;
+            predicted_human.poses.resize(predict_times.size());
+            for(unsigned int i = 0; i < predict_times.size(); ++i)
+            {
+                double time = predict_times[i] + age;
+                auto& predicted_pose = predicted_human.poses[i];
+                predicted_pose.header = tracked_humans->header;
+                predicted_pose.pose.pose.position.x = position.x + velocity.x * time;
+                predicted_pose.pose.pose.position.y = position.y + velocity.y * time;
+                predicted_pose.pose.pose.position.z = position.z;
+                predicted_pose.pose.pose.orientation = segment->pose.pose.orientation;
+
+                // radius of the human is kept in x and y variances
+                double radius = human_radius_;
+                if(velocity_obstacle_)
+                {
+                    radius = std::min(velobs_max_radius_, radius + velobs_mul_ * speed * time);
+                }
+                predicted_pose.pose.covariance.fill(0.0);
+                predicted_pose.pose.covariance[0] = radius;
+                predicted_pose.pose.covariance[7] = radius;
+            }
+        }
+        predicted_humans.resize(human_count);
+
+        return true;
+    }
+}
@@ -28,7 +28,6 @@
  */
 
 // defining constants
-#define PREDICT_SERVICE_NAME "/human_pose_prediction/predict_human_poses"
 #define PUBLISH_MARKERS_SRV_NAME "/human_pose_prediction/publish_prediction_markers"
 
 #define ALPHA_MAX 2.09 // (2*M_PI/3) radians, angle between robot heading and inverse of human heading
@@ -37,38 +36,56 @@
 #define BETA 1.57 // meters, angle from robot front to discard human for collision in comaptibility calculations
 #define MIN_SCALE 0.05 // minimum scaling of velocities that is always allowed regardless if humans are too near
 #define PREDICT_TIME 2.0 // seconds, time for predicting human and robot position, before checking compatibility
+#define PREDICTION_POINTS 10 // predicted poses per human, evenly spaced over the prediction time
+#define PREDICTION_RATE 10.0 // Hz, rate at which human predictions are fetched in background
+#define PREDICTION_MAX_AGE 0.5 // seconds, maximum age of predictions used for compatibility calculations
+
+#define MIN_INDEX_CELL_SIZE 1.0 // meters, smallest cell of the spatial index of humans
+
+#define MEMO_SIZE 4 // scales of recently scored trajectories kept for reuse
+#define MEMO_POSITION_RESOLUTION 0.01 // meters, trajectory points closer than this have the same signature
+#define MEMO_ANGLE_RESOLUTION 0.01 // radians, same for trajectory point orientations
 
 #define MESSAGE_THROTTLE_PERIOD 4.0 // seconds
 
 #include <hanp_local_planner/context_cost_function.h>
 
+
 namespace hanp_local_planner
 {
     // empty constructor and destructor
-    ContextCostFunction::ContextCostFunction() {}
+    ContextCostFunction::ContextCostFunction() : memo_(MEMO_SIZE), memo_next_(0) {}
     ContextCostFunction::~ContextCostFunction() {}
 
-    void ContextCostFunction::initialize(std::string global_frame, tf::TransformListener* tf)
+    void ContextCostFunction::initialize(std::string global_frame, tf::Transformer* tf,
+        boost::shared_ptr<PredictionSource> prediction_source)
     {
-        ros::NodeHandle private_nh("~/");
-        predict_humans_client_ = private_nh.serviceClient<hanp_prediction::HumanPosePredict>(PREDICT_SERVICE_NAME);
-        publish_predicted_markers_client_ = private_nh.serviceClient<std_srvs::SetBool>(PUBLISH_MARKERS_SRV_NAME);
-
         // initialize variables
         global_frame_ = global_frame;
         tf_ = tf;
+
+        if(prediction_source)
+        {
+            ros::NodeHandle private_nh("~/");
+            publish_predicted_markers_client_ = private_nh.serviceClient<std_srvs::SetBool>(PUBLISH_MARKERS_SRV_NAME);
+
+            prediction_cache_.initialize(prediction_source);
+        }
     }
 
     bool ContextCostFunction::prepare()
     {
         // set default parameters
-        setParams(ALPHA_MAX, D_LOW, D_HIGH, BETA, MIN_SCALE, PREDICT_TIME, false);
+        setParams(ALPHA_MAX, D_LOW, D_HIGH, BETA, MIN_SCALE, PREDICT_TIME, PREDICTION_POINTS, PREDICTION_RATE,
+            PREDICTION_MAX_AGE);
+        setPublishPredictedHumanMarkers(false);
 
         return true;
     }
 
     void ContextCostFunction::setParams(double alpha_max, double d_low, double d_high, double beta,
-        double min_scale, double predict_time, bool publish_predicted_human_markers)
+        double min_scale, double predict_time, int prediction_points, double prediction_rate,
+        double prediction_max_age)
     {
         alpha_max_ = alpha_max;
         d_low_ = d_low;
@@ -76,15 +93,24 @@ namespace hanp_local_planner
         beta_ = beta;
         min_scale_ = min_scale;
         predict_time_ = predict_time;
-        publish_predicted_human_markers_ = publish_predicted_human_markers;
+        clearMemo();
+        compatibility_kernel_.setParams(alpha_max_, d_low_, d_high_, beta_);
+        prediction_cache_.setParams(predict_time, std::max(1, prediction_points), prediction_rate,
+            prediction_max_age);
 
         ROS_DEBUG_NAMED("context_cost_function", "context-cost function parameters set: "
-        "alpha_max=%f, d_low=%f, d_high=%f, beta=%f, min_scale=%f, predict_time=%f",
-        alpha_max_, d_low_, d_high_, beta_, min_scale_, predict_time_);
+        "alpha_max=%f, d_low=%f, d_high=%f, beta=%f, min_scale=%f, predict_time=%f, prediction_points=%d, "
+        "prediction_rate=%f, prediction_max_age=%f", alpha_max_, d_low_, d_high_, beta_,
+        min_scale_, predict_time_, prediction_points, prediction_rate, prediction_max_age);
+    }
+
+    void ContextCostFunction::setPublishPredictedHumanMarkers(bool publish_predicted_human_markers)
+    {
+        publish_predicted_human_markers_ = publish_predicted_human_markers;
 
         std_srvs::SetBool publish_predicted_markers_srv;
         publish_predicted_markers_srv.request.data = publish_predicted_human_markers_;
-        if(!publish_predicted_markers_client_ && publish_predicted_markers_client_.call(publish_predicted_markers_srv))
+        if(publish_predicted_markers_client_ && !publish_predicted_markers_client_.call(publish_predicted_markers_srv))
         {
             ROS_WARN_NAMED("context_cost_function", "Failed to call %s service, is human prediction server running?",
             PUBLISH_MARKERS_SRV_NAME);
@@ -96,100 +122,252 @@ namespace hanp_local_planner
         }
      }
 
+    void ContextCostFunction::setMemoize(bool memoize)
+    {
+        memoize_ = memoize;
+        clearMemo();
+    }
+
+    void ContextCostFunction::setClosestApproach(bool closest_approach)
+    {
+        closest_approach_ = closest_approach;
+        clearMemo();
+    }
+
+    void ContextCostFunction::setKeepScoredPredictions(bool keep_scored_predictions)
+    {
+        keep_scored_predictions_ = keep_scored_predictions;
+        scored_predictions_.valid = false;
+    }
+
+    void ContextCostFunction::clearMemo()
+    {
+        for(auto& entry : memo_)
+        {
+            entry.valid = false;
+        }
+    }
+
     // abuse this function to give sclae with with the trajectory should be truncated
     double ContextCostFunction::scoreTrajectory(base_local_planner::Trajectory &traj)
     {
-        // TODO: discard humans, if information is too old
-
-        hanp_prediction::HumanPosePredict predict_srv;
-        double traj_size = traj.getPointsSize();
-        std::vector<double> predict_times;
-        for(double i = 1.0; i <= traj_size; ++i)
+        HumanPredictionCache::Reader predictions(prediction_cache_);
+        if(keep_scored_predictions_)
         {
-            predict_times.push_back(predict_time_ * (i / traj_size));
+            scored_predictions_ = *predictions;
+            scored_predictions_.valid = predictions.isFresh();
         }
-        predict_srv.request.predict_times = predict_times;
-        predict_srv.request.type = hanp_prediction::HumanPosePredictRequest::VELOCITY_OBSTACLE;
-        if(!predict_humans_client_.call(predict_srv))
+        if(!predictions.isFresh())
         {
             ROS_DEBUG_THROTTLE_NAMED(MESSAGE_THROTTLE_PERIOD, "context_cost_function",
-                "failed to call %s service, is prediction server running?", PREDICT_SERVICE_NAME);
+                "no recent human predictions, is prediction source running?");
             return 1.0;
         }
 
-        ROS_DEBUG_NAMED("context_cost_function", "received %lu predicted humans",
-            predict_srv.response.predicted_humans_poses.size());
+        if(!memoize_)
+        {
+            return trajectoryScale(traj, *predictions);
+        }
+
+        // same predictions and same quantized trajectory give the same scale
+        predictionsKey(*predictions, predictions_key_);
+        signature_.resize(3 * traj.getPointsSize());
+        double x, y, theta;
+        for(unsigned int i = 0; i < traj.getPointsSize(); ++i)
+        {
+            traj.getPoint(i, x, y, theta);
+            signature_[3 * i] = std::lround(x / MEMO_POSITION_RESOLUTION);
+            signature_[3 * i + 1] = std::lround(y / MEMO_POSITION_RESOLUTION);
+            signature_[3 * i + 2] = std::lround(angles::normalize_angle(theta) / MEMO_ANGLE_RESOLUTION);
+        }
+        for(const auto& entry : memo_)
+        {
+            if(entry.valid && entry.predictions_key == predictions_key_ && entry.signature == signature_)
+            {
+                ++memo_hits_;
+                ROS_DEBUG_NAMED("context_cost_function", "reusing scale value of %f (%lu hits, %lu misses)",
+                    entry.scale, memo_hits_, memo_misses_);
+                return entry.scale;
+            }
+        }
+        ++memo_misses_;
+
+        double scale = trajectoryScale(traj, *predictions);
+        if(!transformsCurrent(*predictions))
+        {
+            return scale;
+        }
+
+        auto& entry = memo_[memo_next_];
+        memo_next_ = (memo_next_ + 1) % memo_.size();
+        entry.predictions_key = predictions_key_;
+        entry.signature = signature_;
+        entry.scale = scale;
+        entry.valid = true;
+        return scale;
+    }
+
+    void ContextCostFunction::predictionsKey(const PredictionSnapshot& predictions, PredictionsKey& key) const
+    {
+        // predictions of same stamps also use the same frame transforms, see getFrameTransform,
+        // values are kept as they are, so that different predictions never compare equal
+        key.values.clear();
+        key.frame_ids.clear();
+        key.values.push_back(predictions.predict_times.size());
+        for(const auto& predicted_human : predictions.predicted_humans)
+        {
+            key.values.push_back(predicted_human.id);
+            key.values.push_back(predicted_human.poses.size());
+            for(const auto& pose : predicted_human.poses)
+            {
+                key.values.push_back(pose.header.stamp.toNSec());
+            }
+            if(!predicted_human.poses.empty())
+            {
+                key.frame_ids.push_back(predicted_human.poses[0].header.frame_id);
+            }
+        }
+    }
+
+    bool ContextCostFunction::transformsCurrent(const PredictionSnapshot& predictions) const
+    {
+        // a scale computed with a missing or older transform changes once tf catches up
+        for(unsigned int human = 0; human < predictions.predicted_humans.size(); ++human)
+        {
+            const auto& poses = predictions.predicted_humans[human].poses;
+            if(poses.empty())
+            {
+                continue;
+            }
+            if(human_transforms_[human] < 0)
+            {
+                return false;
+            }
+            const auto& frame_transform = frame_transforms_[human_transforms_[human]];
+            if(!frame_transform.identity && frame_transform.stamp != poses[0].header.stamp)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    double ContextCostFunction::trajectoryScale(base_local_planner::Trajectory& traj,
+        const PredictionSnapshot& predictions)
+    {
+        // predictions are fetched in background on a fixed time grid, and interpolated to trajectory times
+        double traj_size = traj.getPointsSize();
+        bool closest_approach = closest_approach_ && traj.getPointsSize() > 1;
+
+        ROS_DEBUG_NAMED("context_cost_function", "using %lu predicted humans, %f seconds old",
+            predictions.predicted_humans.size(), predictions.age().toSec());
+
+        // transform positions of all humans to global frame
+        auto& predicted_humans = predictions.predicted_humans;
+        transformHumanPoses(predicted_humans);
 
-        // transform humans
-        std::vector<hanp_prediction::PredictedPoses> transformed_humans;
-        for (auto human : predict_srv.response.predicted_humans_poses)
+        // future poses of the robot, and of humans at the same time
+        double rx, ry, rtheta;
+        double traj_min_x = INFINITY, traj_min_y = INFINITY, traj_max_x = -INFINITY, traj_max_y = -INFINITY;
+        // kernel positions are relative to the first robot pose, to keep float precision far from the frame origin
+        double origin_x = 0.0, origin_y = 0.0;
+        if(traj.getPointsSize() > 0)
         {
-            transformed_humans.push_back(transformHumanPoses(human));
+            traj.getPoint(0, origin_x, origin_y, rtheta);
         }
-        ROS_DEBUG_NAMED("context_cost_function", "transformied %lu humans to %s frame",
-            transformed_humans.size(), global_frame_.c_str());
+        compatibility_kernel_.reset(closest_approach ? 0 : traj.getPointsSize(), origin_x, origin_y);
+        for(unsigned int point_index = 0; point_index < traj.getPointsSize(); ++point_index)
+        {
+            traj.getPoint(point_index, rx, ry, rtheta);
+            if(!closest_approach)
+            {
+                compatibility_kernel_.setRobotPose(point_index, rx, ry, rtheta);
+            }
 
-        // temporary variables for future robot pose, and compatibility
-        double rx, ry, rtheta, d_p, alpha, compatibility;
-        auto point_index_max = traj.getPointsSize();
+            traj_min_x = std::min(traj_min_x, rx);
+            traj_min_y = std::min(traj_min_y, ry);
+            traj_max_x = std::max(traj_max_x, rx);
+            traj_max_y = std::max(traj_max_y, ry);
+        }
 
-        for(auto transformed_human : transformed_humans)
+        // humans that stay farther than both d_low and d_high from the trajectory corridor are
+        // always compatible, d_low may be the larger one
+        double cull_distance = std::max(d_low_, d_high_);
+        human_index_.clear(std::max(cull_distance, MIN_INDEX_CELL_SIZE));
+        for(unsigned int human = 0; human < predicted_humans.size(); ++human)
         {
-            if (transformed_human.poses.size() == 0)
+            if(human_transforms_[human] < 0)
             {
                 continue;
             }
 
-            unsigned int point_index = 0;
-            do
+            const auto& poses = predicted_humans[human].poses;
+            double min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+            for(unsigned int i = 0; i < poses.size(); ++i)
             {
-                // get the future pose of the robot
-                traj.getPoint(point_index, rx, ry, rtheta);
-                auto future_human_pose = transformed_human.poses[point_index].pose; //TODO: check index validity
-                ROS_DEBUG_NAMED("context_cost_function", "selecting futhre human pose %d of %lu",
-                    point_index, transformed_human.poses.size());
+                // assuming ciruclar human, depending on highest covariance
+                auto radius = std::max(poses[i].pose.covariance[0], poses[i].pose.covariance[7]);
+                auto position = human_positions_.col(human_offsets_[human] + i);
+                min_x = std::min(min_x, position.x() - radius);
+                min_y = std::min(min_y, position.y() - radius);
+                max_x = std::max(max_x, position.x() + radius);
+                max_y = std::max(max_y, position.y() + radius);
+            }
+            human_index_.insert(human, min_x, min_y, max_x, max_y);
+        }
+        human_index_.build();
+        human_index_.query(traj_min_x - cull_distance, traj_min_y - cull_distance, traj_max_x + cull_distance,
+            traj_max_y + cull_distance, nearby_humans_);
+        ROS_DEBUG_NAMED("context_cost_function", "%lu of %lu humans are near the trajectory",
+            nearby_humans_.size(), predicted_humans.size());
 
-                // discard human behind the robot
-                auto a_p = fabs(angles::shortest_angular_distance(rtheta, atan2(ry - future_human_pose.pose.position.y,
-                    rx - future_human_pose.pose.position.x)));
-                if (a_p < beta_)
+        if(closest_approach)
+        {
+            // first point is at predict_time / points, scaled like point indices of the sampled scoring
+            double first_time = predict_time_ / traj_size;
+            auto scaling = predict_time_ > 0.0 ?
+                (closestApproachTime(traj, predictions) - first_time) / (predict_time_ - first_time) : 1.0;
+            ROS_DEBUG_NAMED("context_cost_function", "returning scale value of %f from closest approaches",
+                std::max(min_scale_, scaling));
+            return std::max(min_scale_, scaling);
+        }
+
+        // only nearby humans need interpolating to the times of the trajectory points
+        const auto& times = predictions.predict_times;
+        HumanState state;
+        for(auto human : nearby_humans_)
+        {
+            unsigned int knots = std::min(predicted_humans[human].poses.size(), times.size());
+            if(knots == 0)
+            {
+                continue;
+            }
+            auto human_index = compatibility_kernel_.addHuman();
+            unsigned int next_knot = 0;
+            for(unsigned int point_index = 0; point_index < traj.getPointsSize(); ++point_index)
+            {
+                double t = predict_time_ * ((point_index + 1) / traj_size);
+                while(next_knot < knots && times[next_knot] <= t)
                 {
-                    ROS_DEBUG_NAMED("context_cost_function", "discarding human (%lu)"
-                        " future pose (%u) for compatibility calculations",
-                        transformed_human.id, point_index);
-                    continue;
+                    ++next_knot;
                 }
+                interpolateHuman(human, predictions, knots, next_knot, t, state);
 
-                // calculate distance of robot to person, assuming ciruclar human (depending on highest covariance)
-                d_p = hypot(rx - future_human_pose.pose.position.x, ry - future_human_pose.pose.position.y)
-                    - std::max(future_human_pose.covariance[0], future_human_pose.covariance[7]) ;
-                ROS_DEBUG_NAMED("context_cost_function", "rx=%f, ry=%f, hx=%f, hy=%f, d_p=%f, a_p=%f",
-                    rx, ry, future_human_pose.pose.position.x, future_human_pose.pose.position.y, d_p, a_p);
-                alpha = fabs(angles::shortest_angular_distance(rtheta,
-                    angles::normalize_angle_positive(tf::getYaw(future_human_pose.pose.orientation)) - M_PI));
-                // ROS_DEBUG_NAMED("context_cost_function", "rtheta=%f, h_inv_theta=%f, alpha=%f",
-                // rtheta, angles::normalize_angle_positive(tf::getYaw(future_human_pose.pose.orientation)) - M_PI, alpha);
-
-                // check compatibility
-                compatibility = getCompatabilty(d_p, alpha);
-
-                ROS_DEBUG_NAMED("context_cost_function", "calculated compatibility %f"
-                    " at d_p=%f, alpha=%f point: x=%f, y=%f (%d of %d)", compatibility,
-                    d_p, alpha, rx, ry, point_index, traj.getPointsSize()-1);
+                compatibility_kernel_.setHumanPose(human_index, point_index, state.position.x(), state.position.y(),
+                    state.orientation.x(), state.orientation.y(), state.orientation.z(), state.orientation.w(),
+                    state.radius);
             }
-            // keep calculating, until we find incompatible situation or end of path
-            while((++point_index < point_index_max) && (compatibility > 0.0));
-            point_index_max = point_index;
+        }
 
-            // ROS_DEBUG_NAMED("context_cost_function", "calculated maximum point index %d"
-            //     " (out of %d) for human at x=%d, y=%f", point_index_max, traj.getPointsSize(),
-            //     future_human_pose.pose2d.x, future_human_pose.pose2d.y);
+        // keep the trajectory until first incompatible situation with any human
+        auto point_index_max = compatibility_kernel_.pointIndexMax(traj.getPointsSize());
+        ROS_DEBUG_NAMED("context_cost_function", "calculated maximum point index %u (out of %u) for %u humans",
+            point_index_max, traj.getPointsSize(), compatibility_kernel_.humans());
 
-            // no need to check more when we have to stop
-            if (point_index_max == 1)
-            {
-                return min_scale_;
-            }
+        // no need to move when we have to stop
+        if (point_index_max == 1)
+        {
+            return min_scale_;
         }
 
         auto scaling = (double)(point_index_max - 1) / (double)(traj.getPointsSize() - 1);
@@ -198,6 +376,192 @@ namespace hanp_local_planner
         return std::max(min_scale_, scaling);
     }
 
+    double ContextCostFunction::closestApproachTime(base_local_planner::Trajectory& traj,
+        const PredictionSnapshot& predictions)
+    {
+        // point i is at predict_time_ * (i + 1) / points, as in the sampled scoring
+        unsigned int points = traj.getPointsSize();
+        double robot_dt = predict_time_ / points;
+        if(robot_poses_.cols() < points)
+        {
+            robot_poses_.resize(3, points);
+        }
+        for(unsigned int i = 0; i < points; ++i)
+        {
+            traj.getPoint(i, robot_poses_(0, i), robot_poses_(1, i), robot_poses_(2, i));
+        }
+
+        double cos_beta = std::cos(beta_);
+        const auto& times = predictions.predict_times;
+        double incompatible_time = predict_time_;
+        HumanState state;
+        for(auto human : nearby_humans_)
+        {
+            unsigned int knots = std::min(predictions.predicted_humans[human].poses.size(), times.size());
+            if(knots == 0)
+            {
+                continue;
+            }
+
+            // only positions are needed to find the closest approach
+            auto human_at = [&](double t, unsigned int next_knot) -> Eigen::Vector2d
+            {
+                interpolateHumanPosition(human, predictions, knots, next_knot, t, state);
+                return state.position;
+            };
+
+            // both move linearly between consecutive robot points and predicted times,
+            // the intervals are visited in time order, so the first incident is the earliest
+            unsigned int next_point = 1, next_knot = 0;
+            double t0 = robot_dt;
+            while(next_point < points && t0 < incompatible_time)
+            {
+                while(next_knot < knots && times[next_knot] <= t0)
+                {
+                    ++next_knot;
+                }
+                unsigned int segment = next_point - 1;
+                double t1 = (next_point + 1) * robot_dt;
+                if(next_knot < knots && times[next_knot] < t1)
+                {
+                    t1 = times[next_knot];
+                }
+                else
+                {
+                    ++next_point;
+                }
+
+                auto robot_at = [&](double t) -> Eigen::Vector2d
+                {
+                    double s = std::min(1.0, std::max(0.0, (t - (segment + 1) * robot_dt) / robot_dt));
+                    return (1.0 - s) * robot_poses_.col(segment).head<2>() +
+                        s * robot_poses_.col(segment + 1).head<2>();
+                };
+
+                // relative position a + s * b for s in [0, 1], closest at s_min
+                Eigen::Vector2d a = robot_at(t0) - human_at(t0, next_knot);
+                Eigen::Vector2d b = robot_at(t1) - human_at(t1, next_knot) - a;
+                double bb = b.squaredNorm();
+                double s_min = bb > 0.0 ? std::min(1.0, std::max(0.0, -a.dot(b) / bb)) : 0.0;
+                Eigen::Vector2d d = a + s_min * b;
+                double dist = d.norm();
+                double t_min = t0 + s_min * (t1 - t0);
+                double interval = t1 - t0;
+                t0 = t1;
+
+                interpolateHumanPosition(human, predictions, knots, next_knot, t_min, state);
+                double radius = state.radius;
+                double d_p = dist - radius;
+                if(d_p >= std::max(d_low_, d_high_))
+                {
+                    continue;
+                }
+
+                // discard human behind the robot
+                double rtheta = robot_poses_(2, segment);
+                if(d.x() * std::cos(rtheta) + d.y() * std::sin(rtheta) > cos_beta * dist)
+                {
+                    continue;
+                }
+
+                double threshold;
+                if(d_p <= d_low_)
+                {
+                    threshold = d_low_ + radius;
+                }
+                else
+                {
+                    interpolateHumanOrientation(human, predictions, knots, next_knot, t_min, state);
+                    const auto& orientation = state.orientation;
+                    double human_yaw = std::atan2(2.0 * (orientation.w() * orientation.z() +
+                        orientation.x() * orientation.y()), 1.0 - 2.0 * (orientation.y() * orientation.y() +
+                        orientation.z() * orientation.z()));
+                    double alpha = std::fabs(std::remainder(human_yaw + M_PI - rtheta, 2.0 * M_PI));
+                    if(alpha >= alpha_max_ || alpha > CompatibilityKernel::ATAN2_MAX_ERROR)
+                    {
+                        continue;
+                    }
+                    threshold = d_high_ + radius;
+                }
+
+                // incident starts where the distance first drops to the threshold
+                double s_incident = 0.0;
+                double aa = a.squaredNorm(), ab = a.dot(b);
+                if(aa > threshold * threshold && bb > 0.0)
+                {
+                    double discriminant = std::max(0.0, ab * ab - bb * (aa - threshold * threshold));
+                    s_incident = std::min(s_min, std::max(0.0, (-ab - std::sqrt(discriminant)) / bb));
+                }
+                incompatible_time = std::min(incompatible_time, t_min - (s_min - s_incident) * interval);
+                break;
+            }
+        }
+        return incompatible_time;
+    }
+
+    // predicted poses around time t and weight of the second one
+    static inline void interpolationKnots(const std::vector<double>& times, unsigned int knots,
+        unsigned int next_knot, double t, unsigned int& first, unsigned int& second, double& s)
+    {
+        // humans stay at their first and last predicted poses outside the predicted times
+        first = next_knot == 0 ? 0 : std::min(next_knot, knots) - 1;
+        second = std::min(next_knot, knots - 1);
+        s = 0.0;
+        if(first != second)
+        {
+            s = std::min(1.0, std::max(0.0, (t - times[first]) / (times[second] - times[first])));
+        }
+    }
+
+    void ContextCostFunction::interpolateHuman(unsigned int human, const PredictionSnapshot& predictions,
+        unsigned int knots, unsigned int next_knot, double t, HumanState& state) const
+    {
+        interpolateHumanPosition(human, predictions, knots, next_knot, t, state);
+        interpolateHumanOrientation(human, predictions, knots, next_knot, t, state);
+    }
+
+    void ContextCostFunction::interpolateHumanPosition(unsigned int human, const PredictionSnapshot& predictions,
+        unsigned int knots, unsigned int next_knot, double t, HumanState& state) const
+    {
+        unsigned int first, second;
+        double s;
+        interpolationKnots(predictions.predict_times, knots, next_knot, t, first, second, s);
+
+        const auto& pose_first = predictions.predicted_humans[human].poses[first].pose;
+        const auto& pose_second = predictions.predicted_humans[human].poses[second].pose;
+        auto offset = human_offsets_[human];
+        state.position = (1.0 - s) * human_positions_.col(offset + first).head<2>() +
+            s * human_positions_.col(offset + second).head<2>();
+        state.radius = (1.0 - s) * std::max(pose_first.covariance[0], pose_first.covariance[7]) +
+            s * std::max(pose_second.covariance[0], pose_second.covariance[7]);
+    }
+
+    void ContextCostFunction::interpolateHumanOrientation(unsigned int human, const PredictionSnapshot& predictions,
+        unsigned int knots, unsigned int next_knot, double t, HumanState& state) const
+    {
+        unsigned int first, second;
+        double s;
+        interpolationKnots(predictions.predict_times, knots, next_knot, t, first, second, s);
+
+        // slerp takes the shorter way around, so yaw never jumps at +-pi
+        const auto& poses = predictions.predicted_humans[human].poses;
+        const auto& q_first = poses[first].pose.pose.orientation;
+        state.orientation = Eigen::Quaterniond(q_first.w, q_first.x, q_first.y, q_first.z);
+        if(s > 0.0)
+        {
+            const auto& q_second = poses[second].pose.pose.orientation;
+            state.orientation = state.orientation.slerp(s,
+                Eigen::Quaterniond(q_second.w, q_second.x, q_second.y, q_second.z));
+        }
+
+        const auto& transform = frame_transforms_[human_transforms_[human]];
+        if(!transform.identity)
+        {
+            state.orientation = Eigen::Quaterniond(transform.qw, transform.qx, transform.qy, transform.qz)
+                * state.orientation;
+        }
+    }
+
     double ContextCostFunction::getCompatabilty(double d_p, double alpha)
     {
         if(d_p <= d_low_)
@@ -218,59 +582,120 @@ namespace hanp_local_planner
         }
     }
 
-    hanp_prediction::PredictedPoses ContextCostFunction::transformHumanPoses(
-        hanp_prediction::PredictedPoses& predicted_human)
+    int ContextCostFunction::getFrameTransform(const std::string& frame_id, const ros::Time& stamp)
     {
-        // assuming all predicted poses are in same frame
-        if(predicted_human.poses.size() > 0 && global_frame_ != predicted_human.poses[0].header.frame_id)
+        unsigned int index = 0;
+        while(index < frame_transforms_.size() && frame_transforms_[index].frame_id != frame_id)
+        {
+            ++index;
+        }
+        if(index == frame_transforms_.size())
+        {
+            FrameTransform frame_transform;
+            frame_transform.frame_id = frame_id;
+            frame_transform.valid = false;
+            frame_transform.identity = (frame_id == global_frame_);
+            frame_transforms_.push_back(frame_transform);
+        }
+
+        // look up only once for every new set of predictions
+        auto& frame_transform = frame_transforms_[index];
+        if(frame_transform.identity || (frame_transform.valid && frame_transform.stamp == stamp))
         {
-            auto& frame_id = predicted_human.poses[0].header.frame_id;
-            hanp_prediction::PredictedPoses transformed_human;
+            frame_transform.valid = true;
+            return index;
+        }
 
-            //transform human pose in global frame
-            int res;
-            try
-            {
-                std::string error_msg;
-                res = tf_->waitForTransform(global_frame_, frame_id,
-                    ros::Time(0), ros::Duration(0.5), ros::Duration(0.01), &error_msg);
-                tf::StampedTransform humans_to_global_transform;
-                tf_->lookupTransform(global_frame_, frame_id, ros::Time(0), humans_to_global_transform);
+        // never wait for tf on control thread, keep last known transform if there is no new one
+        std::string error_msg;
+        if(!tf_->canTransform(global_frame_, frame_id, ros::Time(0), &error_msg))
+        {
+            ROS_DEBUG_THROTTLE_NAMED(MESSAGE_THROTTLE_PERIOD, "context_cost_function",
+                "no transform from %s to %s frame: %s", frame_id.c_str(), global_frame_.c_str(), error_msg.c_str());
+            return frame_transform.valid ? index : -1;
+        }
 
-                for(auto predicted_pose : predicted_human.poses)
-                {
-                    // transform position
-                    tf::Pose predicted_pose_tf;
-                    tf::poseMsgToTF(predicted_pose.pose.pose, predicted_pose_tf);
-                    geometry_msgs::Pose predicted_pose_transformed;
-                    tf::poseTFToMsg(humans_to_global_transform * predicted_pose_tf, predicted_pose_transformed);
-
-                    geometry_msgs::PoseWithCovarianceStamped transformed_pose;
-                    transformed_pose.pose.pose = predicted_pose_transformed;
-                    transformed_pose.pose.covariance = predicted_pose.pose.covariance;
-                    transformed_human.poses.push_back(transformed_pose);
-
-                    ROS_DEBUG_NAMED("context_cost_function", "transformed human pose"
-                    " to %s frame, resulting pose: x=%f, y=%f theta=%f",
-                    global_frame_.c_str(), transformed_pose.pose.pose.position.x,
-                    transformed_pose.pose.pose.position.y, tf::getYaw(transformed_pose.pose.pose.orientation));
-                }
-                transformed_human.id = predicted_human.id;
-            }
-            catch(const tf::ExtrapolationException &ex)
+        try
+        {
+            tf::StampedTransform humans_to_global_transform;
+            tf_->lookupTransform(global_frame_, frame_id, ros::Time(0), humans_to_global_transform);
+
+            auto rotation = humans_to_global_transform.getRotation();
+            auto origin = humans_to_global_transform.getOrigin();
+            frame_transform.qx = rotation.x();
+            frame_transform.qy = rotation.y();
+            frame_transform.qz = rotation.z();
+            frame_transform.qw = rotation.w();
+            frame_transform.rotation = Eigen::Quaterniond(rotation.w(), rotation.x(), rotation.y(),
+                rotation.z()).toRotationMatrix();
+            frame_transform.translation = Eigen::Vector3d(origin.x(), origin.y(), origin.z());
+            frame_transform.stamp = stamp;
+            frame_transform.valid = true;
+        }
+        catch(const tf::ExtrapolationException &ex)
+        {
+            ROS_DEBUG("context_cost_function: cannot extrapolate transform");
+        }
+        catch(const tf::TransformException &ex)
+        {
+            ROS_ERROR("context_cost_function: transform failure: %s", ex.what());
+        }
+
+        return frame_transform.valid ? index : -1;
+    }
+
+    void ContextCostFunction::transformHumanPoses(const std::vector<hanp_prediction::PredictedPoses>& predicted_humans)
+    {
+        unsigned int n_poses = 0;
+        for(const auto& predicted_human : predicted_humans)
+        {
+            n_poses += predicted_human.poses.size();
+        }
+        if(human_positions_.cols() < n_poses)
+        {
+            human_positions_.resize(3, n_poses);
+        }
+        human_offsets_.resize(predicted_humans.size() + 1);
+        human_transforms_.resize(predicted_humans.size());
+
+        // assuming all predicted poses of a human are in same frame
+        unsigned int col = 0;
+        for(unsigned int human = 0; human < predicted_humans.size(); ++human)
+        {
+            const auto& poses = predicted_humans[human].poses;
+            human_offsets_[human] = col;
+            human_transforms_[human] = poses.empty() ? -1 :
+                getFrameTransform(poses[0].header.frame_id, poses[0].header.stamp);
+            for(const auto& pose : poses)
             {
-                ROS_DEBUG("context_cost_function: cannot extrapolate transform");
+                const auto& position = pose.pose.pose.position;
+                human_positions_.col(col++) << position.x, position.y, position.z;
             }
-            catch(const tf::TransformException &ex)
+        }
+        human_offsets_[predicted_humans.size()] = col;
+
+        // transform consecutive humans that share a frame in one pass
+        unsigned int human = 0;
+        while(human < predicted_humans.size())
+        {
+            auto transform_index = human_transforms_[human];
+            auto end = human + 1;
+            while(end < predicted_humans.size() && human_transforms_[end] == transform_index)
             {
-                ROS_ERROR("context_cost_function: transform failure (%d): %s", res, ex.what());
+                ++end;
             }
 
-            return transformed_human;
-        }
-        else
-        {
-            return predicted_human;
+            if(transform_index >= 0 && !frame_transforms_[transform_index].identity)
+            {
+                const auto& transform = frame_transforms_[transform_index];
+                auto positions = human_positions_.block(0, human_offsets_[human], 3,
+                    human_offsets_[end] - human_offsets_[human]);
+                positions = (transform.rotation * positions).colwise() + transform.translation;
+            }
+            human = end;
         }
+
+        ROS_DEBUG_NAMED("context_cost_function", "transformed %u poses of %lu humans to %s frame",
+            n_poses, predicted_humans.size(), global_frame_.c_str());
     }
 }
@@ -0,0 +1,168 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/cost_cloud_publisher.h>
+
+#include <pcl_conversions/pcl_conversions.h>
+#include <costmap_2d/cost_values.h>
+
+#define MAX_RATE 1.0 // Hz, default maximum rate of published clouds
+
+namespace hanp_local_planner
+{
+    bool CostGridSnapshot::sameAs(const CostGridSnapshot& other) const
+    {
+        return size_x == other.size_x && size_y == other.size_y && resolution == other.resolution &&
+            origin_x == other.origin_x && origin_y == other.origin_y && obstacle_costs == other.obstacle_costs &&
+            unreachable_costs == other.unreachable_costs && path_scale == other.path_scale &&
+            goal_scale == other.goal_scale && occ_scale == other.occ_scale && path_costs == other.path_costs &&
+            goal_costs == other.goal_costs && occ_costs == other.occ_costs;
+    }
+
+    CostCloudPublisher::CostCloudPublisher() : publish_thread_(NULL), back_(&snapshots_[0]),
+        pending_(&snapshots_[1]), current_(&snapshots_[2]), published_(&snapshots_[3]), has_pending_(false),
+        min_period_(1.0 / MAX_RATE) {}
+
+    CostCloudPublisher::~CostCloudPublisher()
+    {
+        if(publish_thread_)
+        {
+            publish_thread_->interrupt();
+            publish_thread_->join();
+            delete publish_thread_;
+        }
+    }
+
+    void CostCloudPublisher::initialize(ros::NodeHandle& nh, const std::string& frame_id)
+    {
+        frame_id_ = frame_id;
+        publisher_.advertise(nh, "cost_cloud", 1);
+
+        if(!publish_thread_)
+        {
+            publish_thread_ = new boost::thread(boost::bind(&CostCloudPublisher::publishThread, this));
+        }
+    }
+
+    void CostCloudPublisher::setParams(double max_rate)
+    {
+        min_period_ = max_rate > 0.0 ? 1.0 / max_rate : 1.0 / MAX_RATE;
+    }
+
+    bool CostCloudPublisher::ready() const
+    {
+        return publish_thread_ && publisher_.getNumSubscribers() > 0 &&
+            (ros::WallTime::now() - last_publish_).toSec() >= min_period_.load();
+    }
+
+    void CostCloudPublisher::publish()
+    {
+        last_publish_ = ros::WallTime::now();
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            std::swap(back_, pending_);
+            has_pending_ = true;
+        }
+        queued_.notify_one();
+    }
+
+    void CostCloudPublisher::publishThread()
+    {
+        try
+        {
+            while(true)
+            {
+                {
+                    boost::mutex::scoped_lock lock(mutex_);
+                    while(!has_pending_)
+                    {
+                        queued_.wait(lock);
+                    }
+                    std::swap(pending_, current_);
+                    has_pending_ = false;
+                }
+
+                if(current_->sameAs(*published_))
+                {
+                    continue;
+                }
+
+                compose(*current_);
+                publisher_.publish(cloud_);
+                std::swap(current_, published_);
+            }
+        }
+        catch(const boost::thread_interrupted&)
+        {
+            ROS_DEBUG_NAMED("cost_cloud_publisher", "stopped publishing cost clouds");
+        }
+    }
+
+    void CostCloudPublisher::compose(const CostGridSnapshot& snapshot)
+    {
+        cloud_.points.clear();
+        std_msgs::Header header;
+        header.stamp = ros::Time::now();
+        header.frame_id = frame_id_;
+        cloud_.header = pcl_conversions::toPCL(header);
+
+        // same costs as HANPLocalPlanner::getCellCosts used to give to MapGridVisualizer,
+        // composed for a whole row at once
+        unsigned int size_x = snapshot.size_x;
+        base_local_planner::MapGridCostPoint pt;
+        pt.z = 0.0;
+        for(unsigned int y = 0; y < snapshot.size_y; ++y)
+        {
+            Eigen::Map<const Eigen::ArrayXf> path(&snapshot.path_costs[y * size_x], size_x);
+            Eigen::Map<const Eigen::ArrayXf> goal(&snapshot.goal_costs[y * size_x], size_x);
+            Eigen::Map<const Eigen::Array<unsigned char, Eigen::Dynamic, 1> > occ(&snapshot.occ_costs[y * size_x],
+                size_x);
+
+            occ_row_ = occ.cast<float>();
+            valid_row_ = (path != snapshot.obstacle_costs) && (path != snapshot.unreachable_costs) &&
+                (occ_row_ < costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+            total_row_ = snapshot.path_scale * path + snapshot.goal_scale * goal + snapshot.occ_scale * occ_row_;
+
+            pt.y = snapshot.origin_y + (y + 0.5) * snapshot.resolution;
+            for(unsigned int x = 0; x < size_x; ++x)
+            {
+                if(!valid_row_[x])
+                {
+                    continue;
+                }
+                pt.x = snapshot.origin_x + (x + 0.5) * snapshot.resolution;
+                pt.path_cost = path[x];
+                pt.goal_cost = goal[x];
+                pt.occ_cost = occ_row_[x];
+                pt.total_cost = total_row_[x];
+                cloud_.points.push_back(pt);
+            }
+        }
+        cloud_.width = cloud_.points.size();
+        cloud_.height = 1;
+    }
+}
@@ -0,0 +1,357 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// topics of the recorded messages, a cycle ends with its result
+#define PARAMETERS_TOPIC "parameters"
+#define CONFIG_TOPIC "config"
+#define COSTMAP_TOPIC "costmap"
+#define POSE_TOPIC "pose"
+#define VELOCITY_TOPIC "velocity"
+#define PLAN_TOPIC "plan"
+#define FOOTPRINT_TOPIC "footprint"
+#define UNPADDED_FOOTPRINT_TOPIC "unpadded_footprint"
+#define PREDICTION_REQUEST_TOPIC "prediction_request"
+#define PREDICTION_RESPONSE_TOPIC "prediction_response"
+#define PREDICTION_TRANSFORMS_TOPIC "prediction_transforms"
+#define CMD_VEL_TOPIC "cmd_vel"
+#define RESULT_TOPIC "result"
+
+#include <hanp_local_planner/cycle_recorder.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace hanp_local_planner
+{
+    namespace
+    {
+        void footprintToMsg(const std::vector<geometry_msgs::Point>& footprint, geometry_msgs::Polygon& polygon)
+        {
+            polygon.points.resize(footprint.size());
+            for(unsigned int i = 0; i < footprint.size(); ++i)
+            {
+                polygon.points[i].x = footprint[i].x;
+                polygon.points[i].y = footprint[i].y;
+                polygon.points[i].z = footprint[i].z;
+            }
+        }
+
+        template<class M>
+        bool readMessage(const rosbag::MessageInstance& message, M& msg)
+        {
+            auto instance = message.instantiate<M>();
+            if(!instance)
+            {
+                ROS_WARN_NAMED("cycle_recorder", "unexpected type of message on %s topic",
+                    message.getTopic().c_str());
+                return false;
+            }
+            msg = *instance;
+            return true;
+        }
+    }
+
+    CycleRecorder::CycleRecorder() : open_(false), tf_(NULL), cycles_(0), config_changed_(false) {}
+
+    CycleRecorder::~CycleRecorder()
+    {
+        close();
+    }
+
+    bool CycleRecorder::open(std::string file_name, tf::Transformer* tf, std::string global_frame,
+        std::string base_frame, const dynamic_reconfigure::Config& parameters)
+    {
+        close();
+
+        tf_ = tf;
+        global_frame_ = global_frame;
+        base_frame_ = base_frame;
+        try
+        {
+            bag_.open(file_name, rosbag::bagmode::Write);
+            bag_.setCompression(rosbag::compression::LZ4);
+            last_time_ = ros::Time();
+            bag_.write(PARAMETERS_TOPIC, nextTime(), parameters);
+        }
+        catch(const rosbag::BagException& ex)
+        {
+            ROS_ERROR_NAMED("cycle_recorder", "cannot record cycles to %s: %s", file_name.c_str(), ex.what());
+            return false;
+        }
+
+        open_ = true;
+        cycles_ = 0;
+        ROS_INFO_NAMED("cycle_recorder", "recording cycles to %s", file_name.c_str());
+        return true;
+    }
+
+    void CycleRecorder::close()
+    {
+        if(open_)
+        {
+            bag_.close();
+            open_ = false;
+            ROS_INFO_NAMED("cycle_recorder", "recorded %u cycles", cycles_);
+        }
+    }
+
+    ros::Time CycleRecorder::nextTime()
+    {
+        last_time_ = std::max(std::max(ros::Time::now(), last_time_ + ros::Duration(0, 1)), ros::TIME_MIN);
+        return last_time_;
+    }
+
+    void CycleRecorder::setConfig(const HANPLocalPlannerConfig& config)
+    {
+        boost::mutex::scoped_lock l(config_mutex_);
+        config.__toMessage__(config_);
+        config_changed_ = true;
+    }
+
+    void CycleRecorder::record(const costmap_2d::Costmap2D& costmap, const tf::Stamped<tf::Pose>& pose,
+        const tf::Stamped<tf::Pose>& velocity, const std::vector<geometry_msgs::PoseStamped>& plan,
+        const std::vector<geometry_msgs::Point>& footprint,
+        const std::vector<geometry_msgs::Point>& unpadded_footprint,
+        const PredictionSnapshot& predictions, const geometry_msgs::Twist& cmd_vel, CycleResult result)
+    {
+        if(!open_)
+        {
+            return;
+        }
+
+        {
+            boost::mutex::scoped_lock l(config_mutex_);
+            cycle_.config_changed = config_changed_;
+            if(config_changed_)
+            {
+                cycle_.config = config_;
+                config_changed_ = false;
+            }
+        }
+
+        // raw costs, not converted to occupancy values
+        auto& grid = cycle_.costmap;
+        grid.header.stamp = pose.stamp_;
+        grid.header.frame_id = global_frame_;
+        grid.info.resolution = costmap.getResolution();
+        grid.info.width = costmap.getSizeInCellsX();
+        grid.info.height = costmap.getSizeInCellsY();
+        grid.info.origin.position.x = costmap.getOriginX();
+        grid.info.origin.position.y = costmap.getOriginY();
+        grid.data.resize(grid.info.width * grid.info.height);
+        std::memcpy(grid.data.data(), costmap.getCharMap(), grid.data.size());
+
+        tf::poseStampedTFToMsg(pose, cycle_.pose);
+        cycle_.velocity.linear.x = velocity.getOrigin().getX();
+        cycle_.velocity.linear.y = velocity.getOrigin().getY();
+        cycle_.velocity.angular.z = tf::getYaw(velocity.getRotation());
+
+        cycle_.plan.header.stamp = pose.stamp_;
+        cycle_.plan.header.frame_id = global_frame_;
+        cycle_.plan.poses = plan;
+
+        cycle_.footprint.header.stamp = pose.stamp_;
+        cycle_.footprint.header.frame_id = base_frame_;
+        footprintToMsg(footprint, cycle_.footprint.polygon);
+        cycle_.unpadded_footprint.header = cycle_.footprint.header;
+        footprintToMsg(unpadded_footprint, cycle_.unpadded_footprint.polygon);
+
+        // unused or stale predictions are recorded as no humans, both leave trajectories unscaled
+        cycle_.prediction_transforms.transforms.clear();
+        if(predictions.valid)
+        {
+            cycle_.prediction_request.predict_times = predictions.predict_times;
+            cycle_.prediction_response.predicted_humans_poses = predictions.predicted_humans;
+        }
+        else
+        {
+            cycle_.prediction_request.predict_times.clear();
+            cycle_.prediction_response.predicted_humans_poses.clear();
+        }
+
+        // latest transform of every prediction frame, as used for scoring
+        auto& transforms = cycle_.prediction_transforms.transforms;
+        for(const auto& predicted_human : cycle_.prediction_response.predicted_humans_poses)
+        {
+            if(predicted_human.poses.empty())
+            {
+                continue;
+            }
+            const auto& frame_id = predicted_human.poses[0].header.frame_id;
+            if(frame_id == global_frame_ || std::find_if(transforms.begin(), transforms.end(),
+                [&frame_id](const geometry_msgs::TransformStamped& transform)
+                { return transform.child_frame_id == frame_id; }) != transforms.end())
+            {
+                continue;
+            }
+            if(!tf_->canTransform(global_frame_, frame_id, ros::Time(0)))
+            {
+                continue;
+            }
+            try
+            {
+                tf::StampedTransform transform;
+                tf_->lookupTransform(global_frame_, frame_id, ros::Time(0), transform);
+                transforms.resize(transforms.size() + 1);
+                tf::transformStampedTFToMsg(transform, transforms.back());
+            }
+            catch(const tf::TransformException& ex)
+            {
+                ROS_DEBUG_NAMED("cycle_recorder", "cannot record transform of %s frame: %s",
+                    frame_id.c_str(), ex.what());
+            }
+        }
+
+        cycle_.cmd_vel = cmd_vel;
+        std_msgs::UInt8 result_msg;
+        result_msg.data = result;
+
+        try
+        {
+            if(cycle_.config_changed)
+            {
+                bag_.write(CONFIG_TOPIC, nextTime(), cycle_.config);
+            }
+            bag_.write(COSTMAP_TOPIC, nextTime(), cycle_.costmap);
+            bag_.write(POSE_TOPIC, nextTime(), cycle_.pose);
+            bag_.write(VELOCITY_TOPIC, nextTime(), cycle_.velocity);
+            bag_.write(PLAN_TOPIC, nextTime(), cycle_.plan);
+            bag_.write(FOOTPRINT_TOPIC, nextTime(), cycle_.footprint);
+            bag_.write(UNPADDED_FOOTPRINT_TOPIC, nextTime(), cycle_.unpadded_footprint);
+            bag_.write(PREDICTION_REQUEST_TOPIC, nextTime(), cycle_.prediction_request);
+            bag_.write(PREDICTION_RESPONSE_TOPIC, nextTime(), cycle_.prediction_response);
+            bag_.write(PREDICTION_TRANSFORMS_TOPIC, nextTime(), cycle_.prediction_transforms);
+            bag_.write(CMD_VEL_TOPIC, nextTime(), cycle_.cmd_vel);
+            bag_.write(RESULT_TOPIC, nextTime(), result_msg);
+            ++cycles_;
+        }
+        catch(const rosbag::BagException& ex)
+        {
+            ROS_ERROR_NAMED("cycle_recorder", "stopped recording cycles: %s", ex.what());
+            close();
+        }
+    }
+
+    CycleReader::CycleReader() : view_(NULL) {}
+
+    CycleReader::~CycleReader()
+    {
+        delete view_;
+    }
+
+    bool CycleReader::open(std::string file_name)
+    {
+        delete view_;
+        view_ = NULL;
+        try
+        {
+            bag_.open(file_name, rosbag::bagmode::Read);
+        }
+        catch(const rosbag::BagException& ex)
+        {
+            ROS_ERROR_NAMED("cycle_recorder", "cannot read cycles from %s: %s", file_name.c_str(), ex.what());
+            return false;
+        }
+
+        view_ = new rosbag::View(bag_);
+        message_ = view_->begin();
+        return true;
+    }
+
+    bool CycleReader::next(RecordedCycle& cycle)
+    {
+        if(!view_)
+        {
+            return false;
+        }
+
+        cycle.config_changed = false;
+        for(; message_ != view_->end(); ++message_)
+        {
+            const auto& topic = message_->getTopic();
+            if(topic == PARAMETERS_TOPIC)
+            {
+                readMessage(*message_, cycle.parameters);
+            }
+            else if(topic == CONFIG_TOPIC)
+            {
+                cycle.config_changed = readMessage(*message_, cycle.config) || cycle.config_changed;
+            }
+            else if(topic == COSTMAP_TOPIC)
+            {
+                readMessage(*message_, cycle.costmap);
+            }
+            else if(topic == POSE_TOPIC)
+            {
+                readMessage(*message_, cycle.pose);
+            }
+            else if(topic == VELOCITY_TOPIC)
+            {
+                readMessage(*message_, cycle.velocity);
+            }
+            else if(topic == PLAN_TOPIC)
+            {
+                readMessage(*message_, cycle.plan);
+            }
+            else if(topic == FOOTPRINT_TOPIC)
+            {
+                readMessage(*message_, cycle.footprint);
+            }
+            else if(topic == UNPADDED_FOOTPRINT_TOPIC)
+            {
+                readMessage(*message_, cycle.unpadded_footprint);
+            }
+            else if(topic == PREDICTION_REQUEST_TOPIC)
+            {
+                readMessage(*message_, cycle.prediction_request);
+            }
+            else if(topic == PREDICTION_RESPONSE_TOPIC)
+            {
+                readMessage(*message_, cycle.prediction_response);
+            }
+            else if(topic == PREDICTION_TRANSFORMS_TOPIC)
+            {
+                readMessage(*message_, cycle.prediction_transforms);
+            }
+            else if(topic == CMD_VEL_TOPIC)
+            {
+                readMessage(*message_, cycle.cmd_vel);
+            }
+            else if(topic == RESULT_TOPIC)
+            {
+                std_msgs::UInt8 result;
+                if(readMessage(*message_, result))
+                {
+                    cycle.result = result.data;
+                    ++message_;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}
@@ -39,6 +39,10 @@
 //#define PLANNING_FRAME "odom"
 #define ODOM_TOPIC "/odom"
 #define HUMAN_SUB_TOPIC "humans"
+#define PREDICTION_SOURCE "hanp_local_planner/ServicePredictionSource"
+#define REGION_OF_INTEREST_MARGIN 2 // cells added around reachable region for path-distance grids
+#define STATS_PUBLISH_RATE 1.0 // Hz
+#define SLOW_CYCLE_TIME 0.07 // seconds, cycles taking longer are logged with print_calc_times_
 
 #include <hanp_local_planner/hanp_local_planner.h>
 
@@ -46,13 +50,12 @@
 #include <queue>
 
 #include <base_local_planner/goal_functions.h>
-#include <base_local_planner/map_grid_cost_point.h>
 
-#include <pcl_conversions/pcl_conversions.h>
 #include <ros/console.h>
 #include <pluginlib/class_list_macros.h>
 #include <base_local_planner/goal_functions.h>
 #include <nav_msgs/Path.h>
+#include <costmap_2d/footprint.h>
 
 PLUGINLIB_EXPORT_CLASS(hanp_local_planner::HANPLocalPlanner, nav_core::BaseLocalPlanner)
 
@@ -60,8 +63,7 @@ namespace hanp_local_planner
 {
     void HANPLocalPlanner::reconfigureCB(HANPLocalPlannerConfig &config, uint32_t level)
     {
-        boost::mutex::scoped_lock l(configuration_mutex_);
-
+        // only builds a new snapshot, it is applied by the control thread at the start of its next cycle
         if (setup_ && config.restore_defaults)
         {
             config = default_config_;
@@ -73,7 +75,8 @@ namespace hanp_local_planner
             setup_ = true;
         }
 
-        base_local_planner::LocalPlannerLimits limits;
+        boost::shared_ptr<ConfigSnapshot> snapshot(new ConfigSnapshot());
+        base_local_planner::LocalPlannerLimits& limits = snapshot->limits;
         limits.max_trans_vel = config.max_trans_vel;
         limits.min_trans_vel = config.min_trans_vel;
         limits.max_vel_x = config.max_vel_x;
@@ -91,10 +94,96 @@ namespace hanp_local_planner
         limits.prune_plan = config.prune_plan;
         limits.trans_stopped_vel = config.trans_stopped_vel;
         limits.rot_stopped_vel = config.rot_stopped_vel;
+
+        int vx_samp, vy_samp, vth_samp;
+        vx_samp = config.vx_samples;
+        vy_samp = config.vy_samples;
+        vth_samp = config.vth_samples;
+
+        if (vx_samp <= 0)
+        {
+            ROS_WARN("You've specified that you don't want any samples in the x dimension. We'll at least assume that you want to sample one value... so we're going to set vx_samples to 1 instead");
+            vx_samp = 1;
+            config.vx_samples = vx_samp;
+        }
+
+        if (vy_samp <= 0)
+        {
+            ROS_WARN("You've specified that you don't want any samples in the y dimension. We'll at least assume that you want to sample one value... so we're going to set vy_samples to 1 instead");
+            vy_samp = 1;
+            config.vy_samples = vy_samp;
+        }
+
+        if (vth_samp <= 0)
+        {
+            ROS_WARN("You've specified that you don't want any samples in the th dimension. We'll at least assume that you want to sample one value... so we're going to set vth_samples to 1 instead");
+            vth_samp = 1;
+            config.vth_samples = vth_samp;
+        }
+
+        snapshot->vsamples = Eigen::Vector3f(vx_samp, vy_samp, vth_samp);
+        snapshot->config = config;
+
+        // only this thread publishes snapshots
+        boost::shared_ptr<const ConfigSnapshot> previous = boost::atomic_load(&config_);
+
+        // rebuilt only if sampling or limits changed, into a new library as the current one may be in use
+        if(config.motion_primitives)
+        {
+            if(previous && previous->motion_primitives && previous->motion_primitives->hasParameters(
+                config.sim_time, sim_period_, config.sim_granularity, config.angular_sim_granularity, config.use_dwa,
+                limits, snapshot->vsamples, config.primitive_trans_resolution, config.primitive_rot_resolution,
+                config.primitive_max_size))
+            {
+                snapshot->motion_primitives = previous->motion_primitives;
+            }
+            else
+            {
+                boost::shared_ptr<MotionPrimitiveLibrary> motion_primitives(new MotionPrimitiveLibrary());
+                motion_primitives->build(config.sim_time, sim_period_, config.sim_granularity,
+                    config.angular_sim_granularity, config.use_dwa, limits, snapshot->vsamples,
+                    config.primitive_trans_resolution, config.primitive_rot_resolution, config.primitive_max_size);
+                snapshot->motion_primitives = motion_primitives;
+            }
+        }
+
+        // service call, never made from the control thread
+        if(!previous || previous->config.publish_predictions != config.publish_predictions)
+        {
+            context_cost_function_->setPublishPredictedHumanMarkers(config.publish_predictions);
+        }
+
+        traj_cloud_pub_.setParams(config.traj_pc_trajectory_decimation, config.traj_pc_point_decimation,
+            config.traj_pc_max_rate);
+        cost_cloud_pub_.setParams(config.cost_cloud_max_rate);
+        plan_pub_.setParams(config.global_plan_max_rate);
+
+        recorder_.setConfig(config);
+
+        boost::atomic_store(&config_, boost::shared_ptr<const ConfigSnapshot>(snapshot));
+    }
+
+    void HANPLocalPlanner::updateConfig()
+    {
+        boost::shared_ptr<const ConfigSnapshot> config = boost::atomic_load(&config_);
+        if(config && config != applied_config_)
+        {
+            applyConfig(*config);
+            applied_config_ = config;
+        }
+    }
+
+    void HANPLocalPlanner::applyConfig(const ConfigSnapshot& snapshot)
+    {
+        const HANPLocalPlannerConfig& config = snapshot.config;
+        base_local_planner::LocalPlannerLimits limits = snapshot.limits;
         planner_util_.reconfigureCB(limits, config.restore_defaults);
 
         generator_.setParameters(config.sim_time, config.sim_granularity,
             config.angular_sim_granularity, config.use_dwa, sim_period_);
+        sample_space_.setParameters(config.sim_time, sim_period_, config.use_dwa);
+        batch_rollout_.setParameters(config.sim_time, config.sim_granularity,
+            config.angular_sim_granularity, config.use_dwa);
 
         sim_time_ = config.sim_time;
 
@@ -110,6 +199,7 @@ namespace hanp_local_planner
 
         occdist_scale_ = config.occdist_scale;
         obstacle_costs_->setScale(resolution * occdist_scale_);
+        unpadded_obstacle_costs_->setScale(resolution * occdist_scale_);
 
         stop_time_buffer_ = config.stop_time_buffer;
         oscillation_costs_.setOscillationResetDist(config.oscillation_reset_dist, config.oscillation_reset_angle);
@@ -118,55 +208,85 @@ namespace hanp_local_planner
         goal_front_costs_->setXShift(forward_point_distance_);
         //alignment_costs_->setXShift(forward_point_distance_);
         obstacle_costs_->setParams(config.max_trans_vel, config.max_scaling_factor, config.scaling_speed);
+        obstacle_costs_->setTableParams(config.footprint_headings, config.footprint_scaling_levels);
+        unpadded_obstacle_costs_->setParams(config.max_trans_vel, config.max_scaling_factor, config.scaling_speed);
+        unpadded_obstacle_costs_->setTableParams(config.footprint_headings, config.footprint_scaling_levels);
 
         prefer_forward_costs_->setPenalty(config.backward_motion_penalty);
 
         context_cost_function_->setParams(config.cc_alpha_max, config.cc_d_low,
             config.cc_d_high, config.cc_beta, config.cc_min_scale,
-            config.sim_time, config.publish_predictions);
-
-        int vx_samp, vy_samp, vth_samp;
-        vx_samp = config.vx_samples;
-        vy_samp = config.vy_samples;
-        vth_samp = config.vth_samples;
+            config.sim_time, config.cc_prediction_points, config.cc_prediction_rate, config.cc_prediction_max_age);
+        context_cost_function_->setClosestApproach(config.cc_closest_approach);
+        context_cost_function_->setMemoize(config.cc_memoize);
 
-        if (vx_samp <= 0)
-        {
-            ROS_WARN("You've specified that you don't want any samples in the x dimension. We'll at least assume that you want to sample one value... so we're going to set vx_samples to 1 instead");
-            vx_samp = 1;
-            config.vx_samples = vx_samp;
-        }
+        vsamples_ = snapshot.vsamples;
 
-        if (vy_samp <= 0)
-        {
-            ROS_WARN("You've specified that you don't want any samples in the y dimension. We'll at least assume that you want to sample one value... so we're going to set vy_samples to 1 instead");
-            vy_samp = 1;
-            config.vy_samples = vy_samp;
-        }
+        hierarchical_sampling_ = config.hierarchical_sampling;
+        hs_vsamples_[0] = std::max(1, config.hs_vx_samples);
+        hs_vsamples_[1] = std::max(1, config.hs_vy_samples);
+        hs_vsamples_[2] = std::max(1, config.hs_vth_samples);
+        coarse_to_fine_search_.setParameters(config.hs_refine_samples, config.hs_top_k, config.hs_levels);
 
-        if (vth_samp <= 0)
-        {
-            ROS_WARN("You've specified that you don't want any samples in the th dimension. We'll at least assume that you want to sample one value... so we're going to set vth_samples to 1 instead");
-            vth_samp = 1;
-            config.vth_samples = vth_samp;
-        }
+        parallel_planner_.setBounded(config.bounded_scoring);
 
-        vsamples_[0] = vx_samp;
-        vsamples_[1] = vy_samp;
-        vsamples_[2] = vth_samp;
+        motion_primitives_ = snapshot.motion_primitives;
 
         stop_rotate_reduce_factor_ = config.stop_rotate_reduce_factor;
     }
 
-    HANPLocalPlanner::HANPLocalPlanner() : initialized_(false), odom_helper_(ODOM_TOPIC), setup_(false) { }
+    HANPLocalPlanner::HANPLocalPlanner() : initialized_(false), odom_helper_(""), setup_(false), dsrv_(NULL) { }
+
+    void HANPLocalPlanner::initializeCostFunctions(tf::Transformer* tf,
+        boost::shared_ptr<PredictionSource> prediction_source, bool sum_scores, int scoring_threads)
+    {
+        obstacle_costs_ = new hanp_local_planner::ObstacleCostFunction(planner_util_.getCostmap());
+        unpadded_obstacle_costs_ = new hanp_local_planner::ObstacleCostFunction(planner_util_.getCostmap());
+        path_costs_ = new hanp_local_planner::PathDistanceCostFunction(planner_util_.getCostmap());
+        //goal_costs_ = new base_local_planner::MapGridCostFunction(planner_util_.getCostmap(), 0.0, 0.0, true);
+        goal_front_costs_ = new hanp_local_planner::PathDistanceCostFunction(planner_util_.getCostmap(), 0.0, 0.0, true);
+        //alignment_costs_ = new base_local_planner::MapGridCostFunction(planner_util_.getCostmap());
+
+        prefer_forward_costs_ = new base_local_planner::PreferForwardCostFunction(0.0);
+
+        context_cost_function_ =  new hanp_local_planner::ContextCostFunction();
+        context_cost_function_->initialize(planner_util_.getGlobalFrame(), tf, prediction_source);
+
+        goal_front_costs_->setStopOnFailure( false );
+        //alignment_costs_->setStopOnFailure( false );
+
+        oscillation_costs_.resetOscillationFlags();
+        obstacle_costs_->setSumScores(sum_scores);
+        unpadded_obstacle_costs_->setSumScores(sum_scores);
+
+        // cheapest critics first, so that bounded scoring drops trajectories before the
+        // footprint checks of the obstacle costs
+        std::vector<base_local_planner::TrajectoryCostFunction*> critics;
+        critics.push_back(&oscillation_costs_);
+        critics.push_back(prefer_forward_costs_);
+        critics.push_back(goal_front_costs_);
+        //critics.push_back(alignment_costs_);
+        critics.push_back(path_costs_);
+        //critics.push_back(goal_costs_);
+        critics.push_back(obstacle_costs_);
+
+        std::vector<base_local_planner::TrajectorySampleGenerator*> generator_list;
+        generator_list.push_back(&generator_);
+
+        scored_sampling_planner_ = base_local_planner::SimpleScoredSamplingPlanner(generator_list, critics);
+
+        parallel_planner_.initialize(&batch_rollout_, critics, std::max(1, scoring_threads));
+        // trajectories colliding with the padded footprint are scored with the unpadded one in the same pass
+        parallel_planner_.setFallbackCritic(obstacle_costs_, unpadded_obstacle_costs_);
+        coarse_to_fine_search_.initialize(&sample_space_, &batch_rollout_, &parallel_planner_);
+    }
 
     void HANPLocalPlanner::initialize(std::string name, tf::TransformListener* tf, costmap_2d::Costmap2DROS* costmap_ros)
     {
         if (! isInitialized())
         {
             ros::NodeHandle private_nh("~/" + name);
-            g_plan_pub_ = private_nh.advertise<nav_msgs::Path>("global_plan", 1);
-            l_plan_pub_ = private_nh.advertise<nav_msgs::Path>("local_plan", 1);
+            plan_pub_.initialize(private_nh);
             tf_ = tf;
             costmap_ros_ = costmap_ros;
             costmap_ros_->getRobotPose(current_pose_);
@@ -174,20 +294,8 @@ namespace hanp_local_planner
             costmap_2d::Costmap2D* costmap = costmap_ros_->getCostmap();
 
             planner_util_.initialize(tf, costmap, costmap_ros_->getGlobalFrameID());
-
-            obstacle_costs_ = new base_local_planner::ObstacleCostFunction(planner_util_.getCostmap());
-            path_costs_ = new base_local_planner::MapGridCostFunction(planner_util_.getCostmap());
-            //goal_costs_ = new base_local_planner::MapGridCostFunction(planner_util_.getCostmap(), 0.0, 0.0, true);
-            goal_front_costs_ = new base_local_planner::MapGridCostFunction(planner_util_.getCostmap(), 0.0, 0.0, true);
-            //alignment_costs_ = new base_local_planner::MapGridCostFunction(planner_util_.getCostmap());
-
-            prefer_forward_costs_ = new base_local_planner::PreferForwardCostFunction(0.0);
-
-            context_cost_function_ =  new hanp_local_planner::ContextCostFunction();
-            context_cost_function_->initialize(planner_util_.getGlobalFrame(), tf);
-
-            goal_front_costs_->setStopOnFailure( false );
-            //alignment_costs_->setStopOnFailure( false );
+            global_frame_ = costmap_ros_->getGlobalFrameID();
+            base_frame_ = costmap_ros_->getBaseFrameID();
 
             std::string controller_frequency_param_name;
             if(!private_nh.searchParam("controller_frequency", controller_frequency_param_name))
@@ -210,38 +318,65 @@ namespace hanp_local_planner
             }
             ROS_INFO("Sim period is set to %.2f", sim_period_);
 
-            oscillation_costs_.resetOscillationFlags();
-
             bool sum_scores;
             private_nh.param("sum_scores", sum_scores, false);
-            obstacle_costs_->setSumScores(sum_scores);
+
+            // samples are scored in parallel, all critics are read-only while scoring
+            int scoring_threads;
+            private_nh.param("scoring_threads", scoring_threads, (int)boost::thread::hardware_concurrency());
+
+            // human predictions come from a plugin, the prediction service by default
+            std::string prediction_source_name;
+            private_nh.param<std::string>("prediction_source", prediction_source_name, PREDICTION_SOURCE);
+            boost::shared_ptr<PredictionSource> prediction_source;
+            try
+            {
+                prediction_source_loader_.reset(new pluginlib::ClassLoader<PredictionSource>(
+                    "hanp_local_planner", "hanp_local_planner::PredictionSource"));
+                prediction_source = prediction_source_loader_->createInstance(prediction_source_name);
+                prediction_source->initialize(name + "/prediction_source");
+            }
+            catch(const pluginlib::PluginlibException& ex)
+            {
+                // without predictions trajectories are never scaled down for humans
+                ROS_ERROR("Failed to create %s prediction source, humans will be ignored: %s",
+                    prediction_source_name.c_str(), ex.what());
+                prediction_source.reset();
+            }
+
+            initializeCostFunctions(tf, prediction_source, sum_scores, scoring_threads);
 
             private_nh.param("publish_cost_grid_pc", publish_cost_grid_pc_, false);
             ROS_INFO("Will %spublish cost point-cloud", publish_cost_grid_pc_?"":"not ");
-            map_viz_.initialize(name, planner_util_.getGlobalFrame(), boost::bind(&HANPLocalPlanner::getCellCosts, this, _1, _2, _3, _4, _5, _6));
+            cost_cloud_pub_.initialize(private_nh, planner_util_.getGlobalFrame());
 
-            traj_cloud_ = new pcl::PointCloud<base_local_planner::MapGridCostPoint>;
-            traj_cloud_->header.frame_id = costmap_ros_->getGlobalFrameID();
-            traj_cloud_pub_.advertise(private_nh, "trajectory_cloud", 1);
+            traj_cloud_pub_.initialize(private_nh, costmap_ros_->getGlobalFrameID());
             private_nh.param("publish_traj_pc", publish_traj_pc_, false);
             ROS_INFO("Will %spublish trajectory point-cloud", publish_traj_pc_?"":"not ");
 
-            std::vector<base_local_planner::TrajectoryCostFunction*> critics;
-            critics.push_back(&oscillation_costs_);
-            critics.push_back(obstacle_costs_);
-            critics.push_back(goal_front_costs_);
-            //critics.push_back(alignment_costs_);
-            critics.push_back(path_costs_);
-            //critics.push_back(goal_costs_);
-            critics.push_back(prefer_forward_costs_);
-
-            std::vector<base_local_planner::TrajectorySampleGenerator*> generator_list;
-            generator_list.push_back(&generator_);
-
-            scored_sampling_planner_ = base_local_planner::SimpleScoredSamplingPlanner(generator_list, critics);
+            double stats_publish_rate;
+            private_nh.param("stats_publish_rate", stats_publish_rate, STATS_PUBLISH_RATE);
+            latency_stats_.initialize(private_nh, stats_publish_rate, print_calc_times_ ? SLOW_CYCLE_TIME : 0.0);
 
             private_nh.param("cheat_factor", cheat_factor_, 1.0);
 
+            // startup parameters are recorded once, needed to replay cycles as planned here
+            std::string record_file;
+            private_nh.param<std::string>("record_file", record_file, "");
+            if(!record_file.empty())
+            {
+                dynamic_reconfigure::Config parameters;
+                dynamic_reconfigure::DoubleParameter sim_period;
+                sim_period.name = "sim_period";
+                sim_period.value = sim_period_;
+                parameters.doubles.push_back(sim_period);
+                dynamic_reconfigure::BoolParameter sum_scores_parameter;
+                sum_scores_parameter.name = "sum_scores";
+                sum_scores_parameter.value = sum_scores;
+                parameters.bools.push_back(sum_scores_parameter);
+                recorder_.open(record_file, tf, global_frame_, base_frame_, parameters);
+            }
+
             private_nh.param<std::string>("odom_topic", odom_topic_, ODOM_TOPIC);
             odom_helper_.setOdomTopic( odom_topic_ );
             ROS_INFO("Using odometry from topic: %s", odom_helper_.getOdomTopic().c_str());
@@ -258,6 +393,71 @@ namespace hanp_local_planner
         }
     }
 
+    void HANPLocalPlanner::initializeReplay(tf::Transformer* tf, costmap_2d::Costmap2D* costmap,
+        std::string global_frame, std::string base_frame, const dynamic_reconfigure::Config& parameters,
+        int scoring_threads)
+    {
+        if (isInitialized())
+        {
+            ROS_WARN("This planner has already been initialized, doing nothing.");
+            return;
+        }
+
+        // nothing here may create a node handle, it would wait for the ROS master
+        tf_ = NULL;
+        costmap_ros_ = NULL;
+        planner_util_.initialize(NULL, costmap, global_frame);
+        global_frame_ = global_frame;
+        base_frame_ = base_frame;
+
+        sim_period_ = 0.05;
+        bool sum_scores = false;
+        for(const auto& parameter : parameters.doubles)
+        {
+            if(parameter.name == "sim_period")
+            {
+                sim_period_ = parameter.value;
+            }
+        }
+        for(const auto& parameter : parameters.bools)
+        {
+            if(parameter.name == "sum_scores")
+            {
+                sum_scores = parameter.value;
+            }
+        }
+
+        initializeCostFunctions(tf, boost::shared_ptr<PredictionSource>(), sum_scores, scoring_threads);
+
+        publish_cost_grid_pc_ = false;
+        publish_traj_pc_ = false;
+        cheat_factor_ = 1.0;
+
+        initialized_ = true;
+    }
+
+    bool HANPLocalPlanner::replayCycle(tf::Stamped<tf::Pose>& global_pose, const tf::Stamped<tf::Pose>& robot_vel,
+        const std::vector<geometry_msgs::PoseStamped>& transformed_plan,
+        const std::vector<geometry_msgs::Point>& footprint,
+        const std::vector<geometry_msgs::Point>& unpadded_footprint, geometry_msgs::Twist& cmd_vel)
+    {
+        LatencyStats::CycleTimer cycle_timer(latency_stats_);
+        LatencyStats::StageTimer stage_timer(latency_stats_, LatencyStats::COST_UPDATE);
+
+        failures_.clear();
+        current_pose_ = global_pose;
+        footprint_ = footprint;
+        unpadded_footprint_ = unpadded_footprint;
+        obstacle_costs_->setFootprint(footprint_);
+        unpadded_obstacle_costs_->setFootprint(unpadded_footprint_);
+
+        updatePlanAndLocalCosts(current_pose_, transformed_plan);
+
+        // stages are timed inside
+        stage_timer.stop();
+        return hanpComputeVelocityCommands(current_pose_, robot_vel, cmd_vel);
+    }
+
     bool HANPLocalPlanner::setPlan(const std::vector<geometry_msgs::PoseStamped>& orig_global_plan)
     {
         if (! isInitialized())
@@ -287,6 +487,8 @@ namespace hanp_local_planner
             return false;
         }
 
+        updateConfig();
+
         // gettimeofday(&start_e, NULL);
         // start_e_t = start_e.tv_sec + double(start_e.tv_usec) / 1e6;
 
@@ -304,14 +506,7 @@ namespace hanp_local_planner
         if(latchedStopRotateController_.isGoalReached(&planner_util_, odom_helper_, current_pose_))
         {
             // publish last plan with one point same as current robot pose
-            std::vector<geometry_msgs::PoseStamped> local_plan;
-            tf::Stamped<tf::Pose> p = tf::Stamped<tf::Pose>(tf::Pose(
-                tf::createQuaternionFromYaw(0), tf::Point(0.0, 0.0, 0.0)),
-                ros::Time::now(), costmap_ros_->getBaseFrameID());
-            geometry_msgs::PoseStamped pose;
-            tf::poseStampedTFToMsg(p, pose);
-            local_plan.push_back(pose);
-            publishLocalPlan(local_plan);
+            publishLocalPlan(tf::Pose(tf::createQuaternionFromYaw(0), tf::Point(0.0, 0.0, 0.0)), base_frame_);
 
             ROS_INFO("Goal reached");
 
@@ -334,14 +529,62 @@ namespace hanp_local_planner
         }
     }
 
-    void HANPLocalPlanner::publishLocalPlan(std::vector<geometry_msgs::PoseStamped>& path)
+    void HANPLocalPlanner::publishLocalPlan(const base_local_planner::Trajectory& traj)
+    {
+        // empty plans were never published, keep it that way
+        if(traj.getPointsSize() == 0 || !plan_pub_.hasLocalPlanSubscribers())
+        {
+            return;
+        }
+
+        // reuse the message, poses keep their capacity across cycles
+        nav_msgs::Path& local_plan = plan_pub_.localPlan();
+        local_plan.header.stamp = ros::Time::now();
+        local_plan.header.frame_id = global_frame_;
+        local_plan.poses.resize(traj.getPointsSize());
+
+        double p_x, p_y, p_th;
+        for(unsigned int i = 0; i < traj.getPointsSize(); ++i)
+        {
+            traj.getPoint(i, p_x, p_y, p_th);
+
+            auto& pose = local_plan.poses[i];
+            pose.header.stamp = local_plan.header.stamp;
+            pose.header.frame_id = global_frame_;
+            pose.pose.position.x = p_x;
+            pose.pose.position.y = p_y;
+            pose.pose.position.z = 0.0;
+            pose.pose.orientation.x = 0.0;
+            pose.pose.orientation.y = 0.0;
+            pose.pose.orientation.z = std::sin(p_th / 2.0);
+            pose.pose.orientation.w = std::cos(p_th / 2.0);
+        }
+
+        plan_pub_.publishLocalPlan();
+    }
+
+    void HANPLocalPlanner::publishLocalPlan(const tf::Pose& pose, const std::string& frame_id)
     {
-        base_local_planner::publishPlan(path, l_plan_pub_);
+        if(!plan_pub_.hasLocalPlanSubscribers())
+        {
+            return;
+        }
+
+        nav_msgs::Path& local_plan = plan_pub_.localPlan();
+        local_plan.header.stamp = ros::Time::now();
+        local_plan.header.frame_id = frame_id;
+        local_plan.poses.resize(1);
+
+        local_plan.poses[0].header.stamp = local_plan.header.stamp;
+        local_plan.poses[0].header.frame_id = frame_id;
+        tf::poseTFToMsg(pose, local_plan.poses[0].pose);
+
+        plan_pub_.publishLocalPlan();
     }
 
-    void HANPLocalPlanner::publishGlobalPlan(std::vector<geometry_msgs::PoseStamped>& path)
+    void HANPLocalPlanner::publishGlobalPlan(const std::vector<geometry_msgs::PoseStamped>& path)
     {
-        base_local_planner::publishPlan(path, g_plan_pub_);
+        plan_pub_.publishGlobalPlan(path);
     }
 
     HANPLocalPlanner::~HANPLocalPlanner()
@@ -349,12 +592,9 @@ namespace hanp_local_planner
         delete dsrv_;
     }
 
-   bool HANPLocalPlanner::hanpComputeVelocityCommands(tf::Stamped<tf::Pose> &global_pose, geometry_msgs::Twist& cmd_vel)
+   bool HANPLocalPlanner::hanpComputeVelocityCommands(tf::Stamped<tf::Pose> &global_pose,
+        const tf::Stamped<tf::Pose>& robot_vel, geometry_msgs::Twist& cmd_vel)
    {
-        calc_times_ << "\thanp times:\n";
-        auto start_time = ros::Time::now();
-        auto ss_time = start_time;
-
         if(! isInitialized())
         {
             ROS_ERROR("This planner has not been initialized, please call initialize() before using this planner");
@@ -362,22 +602,18 @@ namespace hanp_local_planner
             return false;
         }
 
-        tf::Stamped<tf::Pose> robot_vel;
-        odom_helper_.getRobotVel(robot_vel);
         //ROS_DEBUG("robot vel: x=%f, y=%f, w=%f", robot_vel.getOrigin().getX(), robot_vel.getOrigin().getY(), tf::getYaw(robot_vel.getRotation()));
 
-        auto now = ros::Time::now();
-        calc_times_ << "\t\trobot-vel get time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
+        // findBestPath times its own stages
 
         // struct timeval start, end;
         // double start_t, end_t, t_diff;
         // gettimeofday(&start, NULL);
 
         tf::Stamped<tf::Pose> drive_cmds;
-        drive_cmds.frame_id_ = costmap_ros_->getBaseFrameID();
+        drive_cmds.frame_id_ = base_frame_;
 
-        base_local_planner::Trajectory path = findBestPath(global_pose, robot_vel, drive_cmds, costmap_ros_->getRobotFootprint());
+        base_local_planner::Trajectory path = findBestPath(global_pose, robot_vel, drive_cmds);
         //ROS_ERROR("Best: %.2f, %.2f, %.2f, %.2f", path.xv_, path.yv_, path.thetav_, path.cost_);
 
         // gettimeofday(&end, NULL);
@@ -386,23 +622,13 @@ namespace hanp_local_planner
         // t_diff = end_t - start_t;
         // ROS_INFO("Cycle time: %.9f", t_diff);
 
-        if(path.cost_ < 0 || path.getPointsSize() == 0)
-        {
-            ROS_DEBUG_NAMED("hanp_local_planner", "hanp_local_planner: normal footprint did not work, trying unpadded footprint");
-            path = findBestPath(global_pose, robot_vel, drive_cmds, costmap_ros_->getUnpaddedRobotFootprint());
-        }
-
         cmd_vel.linear.x = drive_cmds.getOrigin().getX();
         cmd_vel.linear.y = drive_cmds.getOrigin().getY();
         cmd_vel.angular.z = tf::getYaw(drive_cmds.getRotation());
 
-        std::vector<geometry_msgs::PoseStamped> local_plan;
-
         if(path.cost_ < 0 || path.getPointsSize() == 0)
         {
             ROS_DEBUG_NAMED("hanp_local_planner", "The hanp local planner failed to find a valid plan, cost functions discarded all candidates. This can mean there is an obstacle too close to the robot.");
-            local_plan.clear();
-            publishLocalPlan(local_plan);
 
             if(path.cost_ < 0)
             {
@@ -416,12 +642,14 @@ namespace hanp_local_planner
             return false;
         }
 
-        now = ros::Time::now();
-        calc_times_ << "\t\tbest-path search time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
+        LatencyStats::StageTimer stage_timer(latency_stats_, LatencyStats::CONTEXT_SCALING);
 
         // check if trajectory need to be scaled down as per context-cost function
+        auto memo_hits = context_cost_function_->memoHits(), memo_misses = context_cost_function_->memoMisses();
         auto trajectory_scale = context_cost_function_->scoreTrajectory(path);
+        latency_stats_.addCount(LatencyStats::CONTEXT_MEMO_HITS, context_cost_function_->memoHits() - memo_hits);
+        latency_stats_.addCount(LatencyStats::CONTEXT_MEMO_MISSES,
+            context_cost_function_->memoMisses() - memo_misses);
         if(trajectory_scale < 1.0)
         {
             // sclae down the trajectory by removing points
@@ -439,44 +667,30 @@ namespace hanp_local_planner
             ROS_DEBUG_NAMED("hanp_local_planner", "hanp local planner scaled the plan by %d %%", (int)(trajectory_scale * 100));
         }
 
-        now = ros::Time::now();
-        calc_times_ << "\t\ttraj-scaling time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
+        stage_timer.next(LatencyStats::PUBLISH);
 
         ROS_DEBUG_NAMED("hanp_local_planner", "A valid velocity command of (%.2f, %.2f, %.2f) was found for this cycle.",
             cmd_vel.linear.x, cmd_vel.linear.y, cmd_vel.angular.z);
 
-        for(unsigned int i = 0; i < path.getPointsSize(); ++i)
-        {
-            double p_x, p_y, p_th;
-            path.getPoint(i, p_x, p_y, p_th);
-
-            tf::Stamped<tf::Pose> p = tf::Stamped<tf::Pose>(tf::Pose(
-                tf::createQuaternionFromYaw(p_th), tf::Point(p_x, p_y, 0.0)),
-                ros::Time::now(), costmap_ros_->getGlobalFrameID());
-            geometry_msgs::PoseStamped pose;
-            tf::poseStampedTFToMsg(p, pose);
-            local_plan.push_back(pose);
-        }
-
-        publishLocalPlan(local_plan);
-
-        now = ros::Time::now();
-        calc_times_ << "\t\tpublish plan time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
+        publishLocalPlan(path);
 
         return true;
     }
 
     bool HANPLocalPlanner::computeVelocityCommandsAccErrors(geometry_msgs::Twist& cmd_vel)
     {
-        calc_times_ << "\ncomputeVelocityCommands:\n";
-        auto start_time = ros::Time::now();
-        auto ss_time = start_time;
+        LatencyStats::CycleTimer cycle_timer(latency_stats_);
+        LatencyStats::StageTimer stage_timer(latency_stats_, LatencyStats::POSE_LOOKUP);
         // struct timeval start_e, end_f;
         // double start_e_t, end_f_t, se_diff;
         // gettimeofday(&start_e, NULL);
         // start_e_t = start_e.tv_sec + double(start_e.tv_usec) / 1e6;
 
+        updateConfig();
+
+        // predictions scored in this cycle are recorded with it
+        context_cost_function_->setKeepScoredPredictions(recorder_.isOpen());
+
         if ( ! costmap_ros_->getRobotPose(current_pose_))
         {
             ROS_ERROR("Could not get robot pose");
@@ -484,9 +698,17 @@ namespace hanp_local_planner
             return false;
         }
 
-        auto now = ros::Time::now();
-        calc_times_ << "\tpose getting time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
+        tf::Stamped<tf::Pose> robot_vel;
+        odom_helper_.getRobotVel(robot_vel);
+        footprint_ = costmap_ros_->getRobotFootprint();
+        unpadded_footprint_ = costmap_ros_->getUnpaddedRobotFootprint();
+
+        // tables cleared by updateConfig are rebuilt before any trajectory is checked,
+        // including by checkTrajectory when stopping and rotating
+        obstacle_costs_->setFootprint(footprint_);
+        unpadded_obstacle_costs_->setFootprint(unpadded_footprint_);
+
+        stage_timer.next(LatencyStats::PLAN_TRANSFORM);
         // gettimeofday(&end_f, NULL);
         // end_f_t = end_f.tv_sec + double(end_f.tv_usec) / 1e6;
         // se_diff = end_f_t - start_e_t;
@@ -506,9 +728,7 @@ namespace hanp_local_planner
         }
         ROS_DEBUG_NAMED("hanp_local_planner", "Received a transformed plan with %zu points.", transformed_plan.size());
 
-        now = ros::Time::now();
-        calc_times_ << "\ttransform plan time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
+        stage_timer.next(LatencyStats::COST_UPDATE);
         // gettimeofday(&end_f, NULL);
         // end_f_t = end_f.tv_sec + double(end_f.tv_usec) / 1e6;
         // se_diff = end_f_t - start_e_t;
@@ -516,23 +736,21 @@ namespace hanp_local_planner
 
         updatePlanAndLocalCosts(current_pose_, transformed_plan);
 
-        now = ros::Time::now();
-        calc_times_ << "\tplan+costs update time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
+        stage_timer.next(LatencyStats::SEARCH);
         // gettimeofday(&end_f, NULL);
         // end_f_t = end_f.tv_sec + double(end_f.tv_usec) / 1e6;
         // se_diff = end_f_t - start_e_t;
         // ROS_INFO("computeVelocityCommands: until updatePlanAndLocalCosts time: %.9f", se_diff);
 
         bool return_value;
-        if (latchedStopRotateController_.isPositionReached(&planner_util_, current_pose_))
+        bool is_stop_rotate = latchedStopRotateController_.isPositionReached(&planner_util_, current_pose_);
+        if (is_stop_rotate)
         {
             // gettimeofday(&end_f, NULL);
             // end_f_t = end_f.tv_sec + double(end_f.tv_usec) / 1e6;
             // se_diff = end_f_t - start_e_t;
             // ROS_INFO("computeVelocityCommands: until isPositionReached time: %.9f", se_diff);
 
-            std::vector<geometry_msgs::PoseStamped> local_plan;
             std::vector<geometry_msgs::PoseStamped> transformed_plan;
 
             base_local_planner::LocalPlannerLimits limits = planner_util_.getCurrentLimits();
@@ -540,17 +758,13 @@ namespace hanp_local_planner
                 limits.getAccLimits(), sim_period_, &planner_util_, odom_helper_,
                 current_pose_, boost::bind(&HANPLocalPlanner::checkTrajectory, this, _1, _2, _3));
 
+            stage_timer.next(LatencyStats::PUBLISH);
             if(local_plan_found)
             {
                 // add final goal direction with current pose to local plan
                 tf::Stamped<tf::Pose> goal_pose;
                 planner_util_.getGoal(goal_pose);
-                tf::Stamped<tf::Pose> p = tf::Stamped<tf::Pose>(tf::Pose(
-                    goal_pose.getRotation(), current_pose_.getOrigin()),
-                    ros::Time::now(), costmap_ros_->getGlobalFrameID());
-                geometry_msgs::PoseStamped pose;
-                tf::poseStampedTFToMsg(p, pose);
-                local_plan.push_back(pose);
+                publishLocalPlan(tf::Pose(goal_pose.getRotation(), current_pose_.getOrigin()), global_frame_);
 
                 // reduce stop_rotate_vel
                 cmd_vel.linear.x *= stop_rotate_reduce_factor_;
@@ -564,10 +778,7 @@ namespace hanp_local_planner
             }
 
             publishGlobalPlan(transformed_plan);
-            publishLocalPlan(local_plan);
 
-            now = ros::Time::now();
-            calc_times_ << "\trotate controller time: " << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
             // gettimeofday(&end_f, NULL);
             // end_f_t = end_f.tv_sec + double(end_f.tv_usec) / 1e6;
             // se_diff = end_f_t - start_e_t;
@@ -582,11 +793,10 @@ namespace hanp_local_planner
             // se_diff = end_f_t - start_e_t;
             // ROS_INFO("computeVelocityCommands: until isPositionReached time: %.9f", se_diff);
 
-            bool isOk = hanpComputeVelocityCommands(current_pose_, cmd_vel);
-
-            now = ros::Time::now();
-            calc_times_ << "\thanp-calc time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-            ss_time = now;
+            // stages are timed inside
+            stage_timer.stop();
+            bool isOk = hanpComputeVelocityCommands(current_pose_, robot_vel, cmd_vel);
+            stage_timer.next(LatencyStats::PUBLISH);
             // gettimeofday(&end_f, NULL);
             // end_f_t = end_f.tv_sec + double(end_f.tv_usec) / 1e6;
             // se_diff = end_f_t - start_e_t;
@@ -602,8 +812,6 @@ namespace hanp_local_planner
                 publishGlobalPlan(empty_plan);
             }
 
-            now = ros::Time::now();
-            calc_times_ << "\tplan publishing time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
             // gettimeofday(&end_f, NULL);
             // end_f_t = end_f.tv_sec + double(end_f.tv_usec) / 1e6;
             // se_diff = end_f_t - start_e_t;
@@ -612,35 +820,35 @@ namespace hanp_local_planner
             return_value = isOk;
         }
 
-        if(print_calc_times_)
-        {
-            calc_times_ << "\n";
-            ROS_INFO_STREAM_COND((now - start_time).toSec() > 0.07, calc_times_.str());
-            calc_times_.str(std::string());
-        }
-        else
+        if(recorder_.isOpen())
         {
-            calc_times_.str(std::string());
+            auto result = !return_value ? CYCLE_FAILED : is_stop_rotate ? CYCLE_STOP_ROTATE : CYCLE_SUCCEEDED;
+            recorder_.record(*planner_util_.getCostmap(), current_pose_, robot_vel, transformed_plan, footprint_,
+                unpadded_footprint_, context_cost_function_->scoredPredictions(), cmd_vel, result);
         }
+
         return return_value;
     }
 
-    bool HANPLocalPlanner::getCellCosts(int cx, int cy, float &path_cost, float &goal_cost, float &occ_cost, float &total_cost)
+    void HANPLocalPlanner::fillCostGridSnapshot(hanp_local_planner::CostGridSnapshot& snapshot)
     {
-        path_cost = path_costs_->getCellCosts(cx, cy);
-        goal_cost = goal_front_costs_->getCellCosts(cx, cy);
-        occ_cost = planner_util_.getCostmap()->getCost(cx, cy);
-        if (path_cost == path_costs_->obstacleCosts() ||
-            path_cost == path_costs_->unreachableCellCosts() ||
-            occ_cost >= costmap_2d::INSCRIBED_INFLATED_OBSTACLE)
-        {
-            return false;
-        }
-
-        double resolution = planner_util_.getCostmap()->getResolution();
-        total_cost = pdist_scale_ * resolution * path_cost +
-            gdist_scale_ * resolution * goal_cost + occdist_scale_ * occ_cost;
-        return true;
+        costmap_2d::Costmap2D* costmap = planner_util_.getCostmap();
+        snapshot.size_x = costmap->getSizeInCellsX();
+        snapshot.size_y = costmap->getSizeInCellsY();
+        snapshot.resolution = costmap->getResolution();
+        snapshot.origin_x = costmap->getOriginX();
+        snapshot.origin_y = costmap->getOriginY();
+
+        const unsigned char* charmap = costmap->getCharMap();
+        snapshot.occ_costs.assign(charmap, charmap + snapshot.size_x * snapshot.size_y);
+        path_costs_->copyCellCosts(snapshot.path_costs);
+        goal_front_costs_->copyCellCosts(snapshot.goal_costs);
+
+        snapshot.obstacle_costs = path_costs_->obstacleCosts();
+        snapshot.unreachable_costs = path_costs_->unreachableCellCosts();
+        snapshot.path_scale = pdist_scale_ * snapshot.resolution;
+        snapshot.goal_scale = gdist_scale_ * snapshot.resolution;
+        snapshot.occ_scale = occdist_scale_;
     }
 
     bool HANPLocalPlanner::checkTrajectory(Eigen::Vector3f pos, Eigen::Vector3f vel, Eigen::Vector3f vel_samples)
@@ -694,6 +902,20 @@ namespace hanp_local_planner
             " points from global plan for path-distance costs", remove_index, global_plan_.size());
         path_costs_->setTargetPoses(remaining_global_plan);
 
+        // trajectories cannot end farther than max velocity for sim_time, path-distance
+        // grids are only computed there
+        base_local_planner::LocalPlannerLimits limits = planner_util_.getCurrentLimits();
+        double max_vel = std::max(limits.max_trans_vel,
+            hypot(std::max(fabs(limits.max_vel_x), fabs(limits.min_vel_x)),
+                std::max(fabs(limits.max_vel_y), fabs(limits.min_vel_y))));
+        double footprint_min_radius, footprint_max_radius;
+        costmap_2d::calculateMinAndMaxDistances(footprint_,
+            footprint_min_radius, footprint_max_radius);
+        double reachable_distance = max_vel * sim_time_ + footprint_max_radius +
+            REGION_OF_INTEREST_MARGIN * planner_util_.getCostmap()->getResolution();
+        path_costs_->setRegionOfInterest(pos[0], pos[1], reachable_distance);
+        goal_front_costs_->setRegionOfInterest(pos[0], pos[1], reachable_distance);
+
         //goal_costs_->setTargetPoses(global_plan_);
 
         geometry_msgs::PoseStamped goal_pose = global_plan_.back();
@@ -742,16 +964,14 @@ namespace hanp_local_planner
     }
 
     base_local_planner::Trajectory HANPLocalPlanner::findBestPath(tf::Stamped<tf::Pose> global_pose,
-        tf::Stamped<tf::Pose> global_vel, tf::Stamped<tf::Pose>& drive_velocities,
-        std::vector<geometry_msgs::Point> footprint_spec)
+        tf::Stamped<tf::Pose> global_vel, tf::Stamped<tf::Pose>& drive_velocities)
     {
-        calc_times_ << "\t\tfinding best path:\n";
-        auto start_time = ros::Time::now();
-        auto ss_time = start_time;
-
-        obstacle_costs_->setFootprint(footprint_spec);
+        LatencyStats::StageTimer stage_timer(latency_stats_, LatencyStats::SEARCH);
 
-        boost::mutex::scoped_lock l(configuration_mutex_);
+        // footprint tables are only cleared by applyConfig, on this thread, setting the
+        // footprint of the cycle again only finds its table
+        obstacle_costs_->setFootprint(footprint_);
+        unpadded_obstacle_costs_->setFootprint(unpadded_footprint_);
 
         Eigen::Vector3f pos(global_pose.getOrigin().getX(), global_pose.getOrigin().getY(), tf::getYaw(global_pose.getRotation()));
         Eigen::Vector3f vel(global_vel.getOrigin().getX(), global_vel.getOrigin().getY(), tf::getYaw(global_vel.getRotation()));
@@ -761,63 +981,57 @@ namespace hanp_local_planner
 
         generator_.initialise(pos, vel, goal, &limits, vsamples_);
 
+        // best velocity of the last search seeds the bound of this one
+        Eigen::Vector3f last_best_vel(result_traj_.xv_, result_traj_.yv_, result_traj_.thetav_);
+        bool has_last_best = result_traj_.cost_ >= 0;
         result_traj_.cost_ = -7;
 
+        // explored trajectories are only collected when the cloud publisher takes them
+        bool publish_traj_pc = publish_traj_pc_ && traj_cloud_pub_.ready();
         std::vector<base_local_planner::Trajectory> all_explored;
-        auto now = ros::Time::now();
-        calc_times_ << "\t\t\tpreparation time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
-
-        scored_sampling_planner_.findBestTrajectory(result_traj_, &all_explored);
-
-        now = ros::Time::now();
-        calc_times_ << "\t\t\ttrajectory search time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
-
-        if(publish_traj_pc_)
-        {
-            base_local_planner::MapGridCostPoint pt;
-            traj_cloud_->points.clear();
-            traj_cloud_->width = 0;
-            traj_cloud_->height = 0;
-            std_msgs::Header header;
-            pcl_conversions::fromPCL(traj_cloud_->header, header);
-            header.stamp = ros::Time::now();
-            traj_cloud_->header = pcl_conversions::toPCL(header);
-            for(std::vector<base_local_planner::Trajectory>::iterator t=all_explored.begin(); t != all_explored.end(); ++t)
+        if(hierarchical_sampling_)
+        {
+            sample_space_.initialise(pos, vel, goal, limits, hs_vsamples_);
+            coarse_to_fine_search_.findBestTrajectory(limits, result_traj_, publish_traj_pc ? &all_explored : NULL);
+        }
+        else
+        {
+            sample_space_.initialise(pos, vel, goal, limits, vsamples_);
+            int primitives = motion_primitives_ ? motion_primitives_->lookup(pos, vel, goal) : -1;
+            if(primitives >= 0)
             {
-                if(t->cost_<0)
-                    continue;
-
-                for(unsigned int i = 0; i < t->getPointsSize(); ++i)
-                {
-                    double p_x, p_y, p_th;
-                    t->getPoint(i, p_x, p_y, p_th);
-                    pt.x=p_x;
-                    pt.y=p_y;
-                    pt.z=0;
-                    pt.path_cost=p_th;
-                    pt.total_cost=t->cost_;
-                    traj_cloud_->push_back(pt);
-                }
+                sample_space_.setSamples(motion_primitives_->samples(primitives));
+                batch_rollout_.transform(motion_primitives_->primitives(primitives), sample_space_, limits);
+            }
+            else
+            {
+                batch_rollout_.rollout(sample_space_, limits);
             }
-            traj_cloud_pub_.publish(*traj_cloud_);
+            unsigned int seed = has_last_best ? sample_space_.nearestSample(last_best_vel) : batch_rollout_.size();
+            parallel_planner_.findBestTrajectory(result_traj_, publish_traj_pc ? &all_explored : NULL, seed);
         }
 
-        if (publish_cost_grid_pc_)
+        if(hierarchical_sampling_ ? coarse_to_fine_search_.usedFallback() : parallel_planner_.usedFallback())
         {
-            map_viz_.publishCostCloud(planner_util_.getCostmap());
+            ROS_DEBUG_NAMED("hanp_local_planner", "hanp_local_planner: normal footprint did not work, using unpadded footprint");
         }
 
-        now = ros::Time::now();
-        calc_times_ << "\t\t\tpublish cost-grid time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
+        stage_timer.next(LatencyStats::PUBLISH);
 
-        oscillation_costs_.updateOscillationFlags(pos, &result_traj_, planner_util_.getCurrentLimits().min_trans_vel);
+        if(publish_traj_pc)
+        {
+            traj_cloud_pub_.publish(all_explored);
+        }
+
+        if (publish_cost_grid_pc_ && cost_cloud_pub_.ready())
+        {
+            fillCostGridSnapshot(cost_cloud_pub_.snapshot());
+            cost_cloud_pub_.publish();
+        }
+
+        stage_timer.next(LatencyStats::SEARCH);
 
-        now = ros::Time::now();
-        calc_times_ << "\t\t\toscillation-flag time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
-        ss_time = now;
+        oscillation_costs_.updateOscillationFlags(pos, &result_traj_, planner_util_.getCurrentLimits().min_trans_vel);
 
         if (result_traj_.cost_ < 0)
         {
@@ -831,8 +1045,6 @@ namespace hanp_local_planner
             matrix.setRotation(tf::createQuaternionFromYaw(result_traj_.thetav_));
             drive_velocities.setBasis(matrix);
         }
-        now = ros::Time::now();
-        calc_times_ << "\t\t\tvel-setting time:\t" << (now - ss_time) << " (" << (now - start_time) << ")" << "\n";
 
         return result_traj_;
     }
@@ -0,0 +1,180 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define MESSAGE_THROTTLE_PERIOD 4.0 // seconds
+#define PREFETCH_RATE 10.0 // Hz, default rate for fetching human predictions
+#define MAX_PREDICTION_AGE 0.5 // seconds, default maximum age of predictions used for scoring
+
+#include <hanp_local_planner/human_prediction_cache.h>
+
+#include <algorithm>
+
+namespace hanp_local_planner
+{
+    HumanPredictionCache::HumanPredictionCache() : prefetch_thread_(NULL), front_(0),
+        predict_points_(1), predict_time_(0.0), prefetch_rate_(PREFETCH_RATE), max_age_(MAX_PREDICTION_AGE)
+    {
+        readers_[0] = 0;
+        readers_[1] = 0;
+    }
+
+    HumanPredictionCache::~HumanPredictionCache()
+    {
+        if(prefetch_thread_)
+        {
+            prefetch_thread_->interrupt();
+            prefetch_thread_->join();
+            delete prefetch_thread_;
+        }
+    }
+
+    void HumanPredictionCache::initialize(boost::shared_ptr<PredictionSource> prediction_source)
+    {
+        prediction_source_ = prediction_source;
+
+        if(!prefetch_thread_)
+        {
+            prefetch_thread_ = new boost::thread(boost::bind(&HumanPredictionCache::prefetchThread, this));
+        }
+    }
+
+    void HumanPredictionCache::setParams(double predict_time, unsigned int predict_points, double prefetch_rate,
+        double max_age)
+    {
+        predict_time_ = predict_time;
+        predict_points_ = predict_points;
+        prefetch_rate_ = prefetch_rate > 0.0 ? prefetch_rate : PREFETCH_RATE;
+        max_age_ = max_age;
+    }
+
+    void HumanPredictionCache::setPredictions(std::vector<hanp_prediction::PredictedPoses>& predicted_humans,
+        std::vector<double>& predict_times)
+    {
+        int back = 1 - front_.load();
+        while(readers_[back].load() != 0)
+        {
+            boost::this_thread::yield();
+        }
+
+        auto& snapshot = snapshots_[back];
+        snapshot.predicted_humans.swap(predicted_humans);
+        snapshot.predict_times.swap(predict_times);
+        snapshot.stamp = ros::Time::now();
+        snapshot.valid = true;
+        front_.store(back);
+    }
+
+    void HumanPredictionCache::prefetchThread()
+    {
+        ROS_DEBUG_NAMED("human_prediction_cache", "started prefetching human predictions");
+
+        try
+        {
+            while(ros::ok())
+            {
+                // only writer of the back buffer, but readers that pinned it before
+                // the last swap may still be using it
+                int back = 1 - front_.load();
+                while(readers_[back].load() != 0)
+                {
+                    boost::this_thread::interruption_point();
+                    boost::this_thread::yield();
+                }
+
+                if(fetch(snapshots_[back]))
+                {
+                    front_.store(back);
+                }
+
+                boost::this_thread::sleep(boost::posix_time::microseconds(
+                    (long)(1e6 / prefetch_rate_.load())));
+            }
+        }
+        catch(const boost::thread_interrupted&)
+        {
+            ROS_DEBUG_NAMED("human_prediction_cache", "stopped prefetching human predictions");
+        }
+    }
+
+    bool HumanPredictionCache::fetch(PredictionSnapshot& snapshot)
+    {
+        double predict_points = std::max(1u, predict_points_.load());
+        double predict_time = predict_time_;
+        std::vector<double> predict_times;
+        // current pose at t = 0, so that humans move from there during the first interval
+        for(double i = 0.0; i <= predict_points; ++i)
+        {
+            predict_times.push_back(predict_time * (i / predict_points));
+        }
+
+        if(!prediction_source_->predict(predict_times, snapshot.predicted_humans))
+        {
+            ROS_DEBUG_THROTTLE_NAMED(MESSAGE_THROTTLE_PERIOD, "human_prediction_cache",
+                "no human predictions from prediction source");
+            return false;
+        }
+
+        snapshot.predict_times.swap(predict_times);
+        snapshot.stamp = ros::Time::now();
+        snapshot.valid = true;
+
+        ROS_DEBUG_NAMED("human_prediction_cache", "received %lu predicted humans",
+            snapshot.predicted_humans.size());
+        return true;
+    }
+
+    HumanPredictionCache::Reader::Reader(HumanPredictionCache& cache) : cache_(cache)
+    {
+        // retry if buffers were swapped before the front buffer got pinned
+        while(true)
+        {
+            index_ = cache_.front_.load();
+            cache_.readers_[index_].fetch_add(1);
+            if(cache_.front_.load() == index_)
+            {
+                break;
+            }
+            cache_.readers_[index_].fetch_sub(1);
+        }
+        snapshot_ = &cache_.snapshots_[index_];
+    }
+
+    HumanPredictionCache::Reader::~Reader()
+    {
+        cache_.readers_[index_].fetch_sub(1);
+    }
+
+    bool HumanPredictionCache::Reader::isFresh() const
+    {
+        if(!snapshot_->valid)
+        {
+            return false;
+        }
+        auto max_age = cache_.max_age_.load();
+        return max_age <= 0.0 || snapshot_->age().toSec() <= max_age;
+    }
+}
@@ -0,0 +1,115 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/human_spatial_index.h>
+
+#include <cmath>
+#include <algorithm>
+
+namespace hanp_local_planner
+{
+    HumanSpatialIndex::HumanSpatialIndex() : cell_size_(1.0), query_id_(0) {}
+
+    void HumanSpatialIndex::clear(double cell_size)
+    {
+        cell_size_ = cell_size > 0.0 ? cell_size : 1.0;
+        entries_.clear();
+        boxes_.clear();
+    }
+
+    int HumanSpatialIndex::cellCoord(double coord) const
+    {
+        return (int)floor(coord / cell_size_);
+    }
+
+    int64_t HumanSpatialIndex::cellKey(int cx, int cy)
+    {
+        return ((int64_t)cx << 32) | (uint32_t)cy;
+    }
+
+    void HumanSpatialIndex::insert(unsigned int human, double min_x, double min_y, double max_x, double max_y)
+    {
+        if(boxes_.size() <= human)
+        {
+            boxes_.resize(human + 1, Box{0.0, 0.0, -1.0, -1.0});
+        }
+        boxes_[human] = Box{min_x, min_y, max_x, max_y};
+
+        for(int cx = cellCoord(min_x); cx <= cellCoord(max_x); ++cx)
+        {
+            for(int cy = cellCoord(min_y); cy <= cellCoord(max_y); ++cy)
+            {
+                entries_.push_back(Entry{cellKey(cx, cy), human});
+            }
+        }
+    }
+
+    void HumanSpatialIndex::build()
+    {
+        std::sort(entries_.begin(), entries_.end());
+        if(query_marks_.size() < boxes_.size())
+        {
+            query_marks_.resize(boxes_.size(), query_id_);
+        }
+    }
+
+    void HumanSpatialIndex::query(double min_x, double min_y, double max_x, double max_y,
+        std::vector<unsigned int>& humans)
+    {
+        humans.clear();
+        if(++query_id_ == 0)
+        {
+            // marks wrapped around, forget all of them
+            std::fill(query_marks_.begin(), query_marks_.end(), 0);
+            query_id_ = 1;
+        }
+
+        for(int cx = cellCoord(min_x); cx <= cellCoord(max_x); ++cx)
+        {
+            for(int cy = cellCoord(min_y); cy <= cellCoord(max_y); ++cy)
+            {
+                Entry first{cellKey(cx, cy), 0};
+                for(auto it = std::lower_bound(entries_.begin(), entries_.end(), first);
+                    it != entries_.end() && it->cell == first.cell; ++it)
+                {
+                    if(query_marks_[it->human] == query_id_)
+                    {
+                        continue;
+                    }
+                    query_marks_[it->human] = query_id_;
+
+                    const auto& box = boxes_[it->human];
+                    if(box.min_x <= max_x && box.max_x >= min_x && box.min_y <= max_y && box.max_y >= min_y)
+                    {
+                        humans.push_back(it->human);
+                    }
+                }
+            }
+        }
+        std::sort(humans.begin(), humans.end());
+    }
+}
@@ -0,0 +1,292 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/latency_stats.h>
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+#define STATS_TOPIC "stats"
+
+namespace hanp_local_planner
+{
+    LatencyHistogram::LatencyHistogram() : sum_(0), max_(0)
+    {
+        for(auto& bucket : buckets_)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    unsigned int LatencyHistogram::bucketIndex(uint64_t nsec)
+    {
+        if(nsec < SUB_BUCKETS)
+        {
+            return nsec;
+        }
+
+        // highest bit selects the magnitude, next bits the linear sub-bucket
+        unsigned int magnitude = 63 - __builtin_clzll(nsec);
+        unsigned int sub_bucket = (nsec >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return SUB_BUCKETS * (magnitude - SUB_BUCKET_BITS + 1) + sub_bucket;
+    }
+
+    uint64_t LatencyHistogram::bucketValue(unsigned int index)
+    {
+        if(index < SUB_BUCKETS)
+        {
+            return index;
+        }
+
+        // upper end of the bucket
+        unsigned int magnitude = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+        uint64_t sub_bucket = index % SUB_BUCKETS;
+        uint64_t width = 1ull << (magnitude - SUB_BUCKET_BITS);
+        return (1ull << magnitude) + sub_bucket * width + width - 1;
+    }
+
+    void LatencyHistogram::record(uint64_t nsec)
+    {
+        buckets_[bucketIndex(nsec)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(nsec, std::memory_order_relaxed);
+
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while(nsec > max && !max_.compare_exchange_weak(max, nsec, std::memory_order_relaxed)) {}
+    }
+
+    LatencyHistogram::Summary LatencyHistogram::collect(bool reset)
+    {
+        // counts are read bucket by bucket, a concurrent record may land in either summary
+        std::vector<uint64_t> counts(BUCKETS);
+        Summary summary = {0, 0, 0, 0, 0.0};
+        for(unsigned int i = 0; i < BUCKETS; ++i)
+        {
+            counts[i] = reset ? buckets_[i].exchange(0, std::memory_order_relaxed) :
+                buckets_[i].load(std::memory_order_relaxed);
+            summary.count += counts[i];
+        }
+        uint64_t sum = reset ? sum_.exchange(0, std::memory_order_relaxed) : sum_.load(std::memory_order_relaxed);
+        summary.max = reset ? max_.exchange(0, std::memory_order_relaxed) : max_.load(std::memory_order_relaxed);
+        if(summary.count == 0)
+        {
+            return summary;
+        }
+        summary.mean = (double)sum / summary.count;
+
+        uint64_t p50_rank = (summary.count + 1) / 2, p99_rank = (summary.count * 99 + 99) / 100;
+        uint64_t seen = 0;
+        for(unsigned int i = 0; i < BUCKETS && seen < p99_rank; ++i)
+        {
+            if(counts[i] == 0)
+            {
+                continue;
+            }
+            if(seen < p50_rank && seen + counts[i] >= p50_rank)
+            {
+                summary.p50 = std::min(bucketValue(i), summary.max);
+            }
+            seen += counts[i];
+            if(seen >= p99_rank)
+            {
+                summary.p99 = std::min(bucketValue(i), summary.max);
+            }
+        }
+        return summary;
+    }
+
+    LatencyStats::StageTimer::StageTimer(LatencyStats& stats, Stage stage) : stats_(stats), stage_(stage),
+        running_(true), start_(Clock::now()) {}
+
+    void LatencyStats::StageTimer::next(Stage stage)
+    {
+        auto now = Clock::now();
+        if(running_)
+        {
+            stats_.addStageTime(stage_, now - start_);
+        }
+        stage_ = stage;
+        start_ = now;
+        running_ = true;
+    }
+
+    void LatencyStats::StageTimer::stop()
+    {
+        if(running_)
+        {
+            stats_.addStageTime(stage_, Clock::now() - start_);
+            running_ = false;
+        }
+    }
+
+    LatencyStats::LatencyStats() : slow_cycle_time_(0.0)
+    {
+        for(auto& counter : counters_)
+        {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        for(unsigned int stage = 0; stage < N_STAGES; ++stage)
+        {
+            cycle_times_[stage] = Clock::duration::zero();
+            cycle_stages_[stage] = false;
+        }
+    }
+
+    void LatencyStats::initialize(ros::NodeHandle& nh, double publish_rate, double slow_cycle_time)
+    {
+        slow_cycle_time_ = slow_cycle_time;
+        if(publish_rate > 0.0)
+        {
+            stats_pub_ = nh.advertise<diagnostic_msgs::DiagnosticArray>(STATS_TOPIC, 1);
+            stats_timer_ = nh.createWallTimer(ros::WallDuration(1.0 / publish_rate), &LatencyStats::publishStats, this);
+        }
+    }
+
+    const char* LatencyStats::stageName(Stage stage)
+    {
+        switch(stage)
+        {
+            case POSE_LOOKUP: return "pose lookup";
+            case PLAN_TRANSFORM: return "plan transform";
+            case COST_UPDATE: return "cost update";
+            case SEARCH: return "search";
+            case CONTEXT_SCALING: return "context scaling";
+            case PUBLISH: return "publish";
+            case CYCLE: return "cycle";
+            default: return "unknown";
+        }
+    }
+
+    const char* LatencyStats::counterName(Counter counter)
+    {
+        switch(counter)
+        {
+            case CONTEXT_MEMO_HITS: return "context memo hits";
+            case CONTEXT_MEMO_MISSES: return "context memo misses";
+            default: return "unknown";
+        }
+    }
+
+    void LatencyStats::addStageTime(Stage stage, Clock::duration duration)
+    {
+        cycle_times_[stage] += duration;
+        cycle_stages_[stage] = true;
+    }
+
+    void LatencyStats::beginCycle()
+    {
+        for(unsigned int stage = 0; stage < N_STAGES; ++stage)
+        {
+            cycle_times_[stage] = Clock::duration::zero();
+            cycle_stages_[stage] = false;
+        }
+        cycle_start_ = Clock::now();
+    }
+
+    void LatencyStats::endCycle()
+    {
+        addStageTime(CYCLE, Clock::now() - cycle_start_);
+
+        for(unsigned int stage = 0; stage < N_STAGES; ++stage)
+        {
+            if(cycle_stages_[stage])
+            {
+                histograms_[stage].record(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(cycle_times_[stage]).count());
+            }
+        }
+
+        // formatting only happens for slow cycles
+        double cycle_time = std::chrono::duration<double>(cycle_times_[CYCLE]).count();
+        if(slow_cycle_time_ > 0.0 && cycle_time > slow_cycle_time_)
+        {
+            char stages[512];
+            int length = 0;
+            for(unsigned int stage = 0; stage < CYCLE && length < (int)sizeof(stages); ++stage)
+            {
+                if(cycle_stages_[stage])
+                {
+                    length += snprintf(stages + length, sizeof(stages) - length, "\n\t%s:\t%.6f", stageName((Stage)stage),
+                        std::chrono::duration<double>(cycle_times_[stage]).count());
+                }
+            }
+            ROS_INFO_NAMED("hanp_local_planner", "computeVelocityCommands took %.6f s:%s", cycle_time, stages);
+        }
+    }
+
+    void LatencyStats::publishStats(const ros::WallTimerEvent& event)
+    {
+        diagnostic_msgs::DiagnosticArray stats;
+        stats.header.stamp = ros::Time::now();
+
+        char value[32];
+        for(unsigned int stage = 0; stage < N_STAGES; ++stage)
+        {
+            // each message covers cycles since the previous one
+            auto summary = histograms_[stage].collect(true);
+
+            diagnostic_msgs::DiagnosticStatus status;
+            status.level = diagnostic_msgs::DiagnosticStatus::OK;
+            status.name = std::string("hanp_local_planner: ") + stageName((Stage)stage);
+            status.message = summary.count > 0 ? "latency in ms" : "no samples";
+
+            diagnostic_msgs::KeyValue key_value;
+            key_value.key = "count";
+            key_value.value = std::to_string(summary.count);
+            status.values.push_back(key_value);
+
+            const std::pair<const char*, double> values[] = {
+                std::make_pair("p50", summary.p50 * 1e-6), std::make_pair("p99", summary.p99 * 1e-6),
+                std::make_pair("max", summary.max * 1e-6), std::make_pair("mean", summary.mean * 1e-6)};
+            for(const auto& entry : values)
+            {
+                snprintf(value, sizeof(value), "%.3f", entry.second);
+                key_value.key = entry.first;
+                key_value.value = value;
+                status.values.push_back(key_value);
+            }
+            stats.status.push_back(status);
+        }
+
+        diagnostic_msgs::DiagnosticStatus counters;
+        counters.level = diagnostic_msgs::DiagnosticStatus::OK;
+        counters.name = "hanp_local_planner: counters";
+        counters.message = "events since last message";
+        for(unsigned int counter = 0; counter < N_COUNTERS; ++counter)
+        {
+            diagnostic_msgs::KeyValue key_value;
+            key_value.key = counterName((Counter)counter);
+            key_value.value = std::to_string(collectCount((Counter)counter));
+            counters.values.push_back(key_value);
+        }
+        stats.status.push_back(counters);
+
+        stats_pub_.publish(stats);
+    }
+}
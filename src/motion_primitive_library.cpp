@@ -0,0 +1,170 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/motion_primitive_library.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <ros/ros.h>
+
+#define FAR_GOAL_DISTANCE 1e6 // m, goal distance that does not bound the samples while building
+#define MIN_RESOLUTION 1e-3 // m/s or rad/s, smallest resolution of the current velocity grid
+
+namespace hanp_local_planner
+{
+    MotionPrimitiveLibrary::MotionPrimitiveLibrary() : sim_time_(0.0), use_dwa_(true), max_vel_x_(0.0),
+        max_vel_y_(0.0), min_vel_(Eigen::Vector3f::Zero()), resolution_(Eigen::Vector3f::Ones()),
+        size_(Eigen::Vector3i::Zero()) {}
+
+    std::vector<double> MotionPrimitiveLibrary::parameterVector(double sim_time, double sim_period,
+        double sim_granularity, double angular_sim_granularity, bool use_dwa,
+        const base_local_planner::LocalPlannerLimits& limits, const Eigen::Vector3f& vsamples,
+        double trans_resolution, double rot_resolution, double max_size)
+    {
+        return {sim_time, sim_period, sim_granularity, angular_sim_granularity,
+            (double)use_dwa, limits.max_trans_vel, limits.min_trans_vel, limits.max_vel_x, limits.min_vel_x,
+            limits.max_vel_y, limits.min_vel_y, limits.max_rot_vel, limits.min_rot_vel, limits.acc_lim_x,
+            limits.acc_lim_y, limits.acc_lim_theta, vsamples[0], vsamples[1], vsamples[2], trans_resolution,
+            rot_resolution, max_size};
+    }
+
+    bool MotionPrimitiveLibrary::hasParameters(double sim_time, double sim_period, double sim_granularity,
+        double angular_sim_granularity, bool use_dwa, const base_local_planner::LocalPlannerLimits& limits,
+        const Eigen::Vector3f& vsamples, double trans_resolution, double rot_resolution, double max_size) const
+    {
+        return parameterVector(sim_time, sim_period, sim_granularity, angular_sim_granularity, use_dwa, limits,
+            vsamples, trans_resolution, rot_resolution, max_size) == parameters_;
+    }
+
+    bool MotionPrimitiveLibrary::build(double sim_time, double sim_period, double sim_granularity,
+        double angular_sim_granularity, bool use_dwa, const base_local_planner::LocalPlannerLimits& limits,
+        const Eigen::Vector3f& vsamples, double trans_resolution, double rot_resolution, double max_size)
+    {
+        std::vector<double> parameters = parameterVector(sim_time, sim_period, sim_granularity,
+            angular_sim_granularity, use_dwa, limits, vsamples, trans_resolution, rot_resolution, max_size);
+        if(parameters == parameters_)
+        {
+            return isBuilt();
+        }
+        clear();
+        parameters_ = parameters;
+
+        sim_time_ = sim_time;
+        use_dwa_ = use_dwa;
+        max_vel_x_ = limits.max_vel_x;
+        max_vel_y_ = limits.max_vel_y;
+
+        Eigen::Vector3f max_vel(limits.max_vel_x, limits.max_vel_y, limits.max_rot_vel);
+        min_vel_ = Eigen::Vector3f(limits.min_vel_x, limits.min_vel_y, -limits.max_rot_vel);
+        resolution_ = Eigen::Vector3f(std::max(trans_resolution, MIN_RESOLUTION),
+            std::max(trans_resolution, MIN_RESOLUTION), std::max(rot_resolution, MIN_RESOLUTION));
+        for(unsigned int d = 0; d < 3; ++d)
+        {
+            size_[d] = std::max(0, (int)floor((max_vel[d] - min_vel_[d]) / resolution_[d] + 0.5)) + 1;
+        }
+
+        VelocitySampleSpace sample_space;
+        sample_space.setParameters(sim_time, sim_period, use_dwa);
+
+        Eigen::Vector3f origin = Eigen::Vector3f::Zero();
+        Eigen::Vector3f goal(FAR_GOAL_DISTANCE, 0.0, 0.0);
+        unsigned int n_velocities = size_.prod();
+        samples_.resize(n_velocities);
+        primitives_.resize(n_velocities);
+        auto grid_vel = [&](unsigned int i)
+        {
+            // same order as lookup
+            Eigen::Vector3i index(i / (size_[1] * size_[2]), (i / size_[2]) % size_[1], i % size_[2]);
+            return Eigen::Vector3f((min_vel_ + index.cast<float>().cwiseProduct(resolution_)).cwiseMin(max_vel));
+        };
+
+        // size of the rollouts is known from the samples, before integrating any of them
+        double size = 0.0;
+        for(unsigned int i = 0; i < n_velocities; ++i)
+        {
+            sample_space.initialise(origin, grid_vel(i), goal, limits, vsamples);
+            samples_[i] = sample_space.samples();
+            primitives_[i].setParameters(sim_time, sim_granularity, angular_sim_granularity, use_dwa);
+            size += (double)primitives_[i].maxSteps(sample_space, limits) * samples_[i].size() * 3.0 * sizeof(float)
+                / (1024.0 * 1024.0);
+        }
+        if(size > max_size)
+        {
+            ROS_WARN_NAMED("motion_primitive_library", "motion primitives of %u velocities need %.0f MB, more than "
+                "%.0f MB, trajectories will be integrated every cycle, increase the resolutions or max size",
+                n_velocities, size, max_size);
+            samples_.clear();
+            primitives_.clear();
+            return false;
+        }
+
+        for(unsigned int i = 0; i < n_velocities; ++i)
+        {
+            sample_space.initialise(origin, grid_vel(i), goal, limits, vsamples);
+            primitives_[i].rollout(sample_space, limits);
+        }
+
+        ROS_INFO_NAMED("motion_primitive_library", "built motion primitives of %u velocities (%d x %d x %d), %.1f MB",
+            n_velocities, size_[0], size_[1], size_[2], size);
+        return true;
+    }
+
+    void MotionPrimitiveLibrary::clear()
+    {
+        parameters_.clear();
+        samples_.clear();
+        primitives_.clear();
+    }
+
+    int MotionPrimitiveLibrary::lookup(const Eigen::Vector3f& pos, const Eigen::Vector3f& vel,
+        const Eigen::Vector3f& goal) const
+    {
+        if(!isBuilt())
+        {
+            return -1;
+        }
+
+        // without dwa, VelocitySampleSpace bounds velocities by the distance to the goal
+        if(!use_dwa_)
+        {
+            double max_vel = hypot(goal[0] - pos[0], goal[1] - pos[1]) / sim_time_;
+            if(max_vel < max_vel_x_ || max_vel < max_vel_y_)
+            {
+                return -1;
+            }
+        }
+
+        int i = 0;
+        for(unsigned int d = 0; d < 3; ++d)
+        {
+            int index = std::min(std::max(0, (int)floor((vel[d] - min_vel_[d]) / resolution_[d] + 0.5)), size_[d] - 1);
+            i = i * size_[d] + index;
+        }
+        return i;
+    }
+}
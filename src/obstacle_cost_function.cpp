@@ -0,0 +1,380 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/obstacle_cost_function.h>
+
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+
+#include <ros/console.h>
+#include <base_local_planner/line_iterator.h>
+#include <costmap_2d/cost_values.h>
+
+#define MAX_FOOTPRINT_TABLES 2 // footprints for which tables are kept
+
+namespace hanp_local_planner
+{
+    ObstacleCostFunction::ObstacleCostFunction(costmap_2d::Costmap2D* costmap) : costmap_(costmap),
+        max_trans_vel_(0.0), max_scaling_factor_(0.0), scaling_speed_(0.0), headings_(72), scaling_levels_(1),
+        sum_scores_(false) {}
+
+    void ObstacleCostFunction::setParams(double max_trans_vel, double max_scaling_factor, double scaling_speed)
+    {
+        if(max_scaling_factor != max_scaling_factor_)
+        {
+            tables_.clear();
+        }
+        max_trans_vel_ = max_trans_vel;
+        max_scaling_factor_ = max_scaling_factor;
+        scaling_speed_ = scaling_speed;
+    }
+
+    void ObstacleCostFunction::setTableParams(int headings, int scaling_levels)
+    {
+        headings = std::max(1, headings);
+        scaling_levels = std::max(1, scaling_levels);
+        if(headings != headings_ || scaling_levels != scaling_levels_)
+        {
+            tables_.clear();
+        }
+        headings_ = headings;
+        scaling_levels_ = scaling_levels;
+    }
+
+    void ObstacleCostFunction::setFootprint(const std::vector<geometry_msgs::Point>& footprint_spec)
+    {
+        auto same_footprint = [&footprint_spec](const FootprintTable& table)
+        {
+            return footprint_spec.size() == table.footprint.size() && std::equal(footprint_spec.begin(),
+                footprint_spec.end(), table.footprint.begin(), [](const geometry_msgs::Point& a,
+                const geometry_msgs::Point& b)
+                {
+                    return a.x == b.x && a.y == b.y;
+                });
+        };
+
+        auto table = std::find_if(tables_.begin(), tables_.end(), same_footprint);
+        if(table != tables_.end())
+        {
+            std::rotate(tables_.begin(), table, table + 1);
+            return;
+        }
+
+        if(tables_.size() == MAX_FOOTPRINT_TABLES)
+        {
+            tables_.pop_back();
+        }
+        tables_.insert(tables_.begin(), FootprintTable());
+        tables_.front().footprint = footprint_spec;
+        buildTable(tables_.front());
+    }
+
+    bool ObstacleCostFunction::prepare()
+    {
+        if(tables_.empty())
+        {
+            return true;
+        }
+
+        FootprintTable& table = tables_.front();
+        if(table.resolution != costmap_->getResolution())
+        {
+            buildTable(table);
+        }
+        else if(table.size_x != costmap_->getSizeInCellsX())
+        {
+            updateIndices(table);
+        }
+        return true;
+    }
+
+    double ObstacleCostFunction::scoreTrajectory(base_local_planner::Trajectory &traj)
+    {
+        if(tables_.empty() || tables_.front().footprint.empty())
+        {
+            ROS_ERROR("Footprint spec is empty, maybe missing call to setFootprint?");
+            return -9.0;
+        }
+
+        const FootprintTable& table = tables_.front();
+        unsigned int level = scalingLevel(traj);
+        double cost = 0.0;
+        double px, py, pth;
+        for(unsigned int i = 0; i < traj.getPointsSize(); ++i)
+        {
+            traj.getPoint(i, px, py, pth);
+            double f_cost = footprintCost(table, px, py, pth, level);
+            if(f_cost < 0)
+            {
+                return f_cost;
+            }
+
+            if(sum_scores_)
+            {
+                cost += f_cost;
+            }
+            else
+            {
+                cost = std::max(cost, f_cost);
+            }
+        }
+        return cost;
+    }
+
+    void ObstacleCostFunction::buildTable(FootprintTable& table) const
+    {
+        table.resolution = costmap_->getResolution();
+        table.offsets.assign(scaling_levels_ * headings_, std::vector<std::pair<int, int> >());
+        table.margin_offsets.assign(scaling_levels_ * headings_, std::vector<std::pair<int, int> >());
+        table.bounds.assign(scaling_levels_ * headings_, CellBounds{0, 0, 0, 0});
+
+        // footprints of less than 3 points are checked at the robot cell only
+        unsigned int n_points = table.footprint.size();
+        if(n_points >= 3)
+        {
+            std::vector<std::pair<int, int> > vertices(n_points);
+            double radius = 0.0;
+            for(const auto& point : table.footprint)
+            {
+                radius = std::max(radius, hypot(point.x, point.y));
+            }
+            for(int level = 0; level < scaling_levels_; ++level)
+            {
+                double scale = levelScale(level);
+
+                // the exact perimeter moves by up to the chord of half a heading step when the heading
+                // is snapped, plus a cell for the robot being anywhere in its cell and vertex rounding
+                double radius_cells = scale * radius / table.resolution;
+                int margin = 1 + (int)ceil(radius_cells * 2.0 * sin(M_PI / (2.0 * headings_)));
+                for(int heading = 0; heading < headings_; ++heading)
+                {
+                    // vertex cells for the robot at the center of its cell, as in CostmapModel::footprintCost
+                    double th = 2.0 * M_PI * heading / headings_;
+                    double cos_th = cos(th), sin_th = sin(th);
+                    for(unsigned int i = 0; i < n_points; ++i)
+                    {
+                        const auto& point = table.footprint[i];
+                        double x = scale * (point.x * cos_th - point.y * sin_th) / table.resolution;
+                        double y = scale * (point.x * sin_th + point.y * cos_th) / table.resolution;
+                        vertices[i] = std::make_pair((int)floor(x + 0.5), (int)floor(y + 0.5));
+                    }
+
+                    auto& offsets = table.offsets[level * headings_ + heading];
+                    for(unsigned int i = 0; i < n_points; ++i)
+                    {
+                        const auto& start = vertices[i];
+                        const auto& end = vertices[(i + 1) % n_points];
+                        for(base_local_planner::LineIterator line(start.first, start.second, end.first, end.second);
+                            line.isValid(); line.advance())
+                        {
+                            offsets.push_back(std::make_pair(line.getX(), line.getY()));
+                        }
+                    }
+
+                    // row-major order keeps the gather sequential in the costmap
+                    auto row_major = [](const std::pair<int, int>& a, const std::pair<int, int>& b)
+                    {
+                        return a.second < b.second || (a.second == b.second && a.first < b.first);
+                    };
+                    std::sort(offsets.begin(), offsets.end(), row_major);
+                    offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+                    std::vector<std::pair<int, int> > dilated;
+                    for(const auto& offset : offsets)
+                    {
+                        for(int dy = -margin; dy <= margin; ++dy)
+                        {
+                            for(int dx = -margin; dx <= margin; ++dx)
+                            {
+                                dilated.push_back(std::make_pair(offset.first + dx, offset.second + dy));
+                            }
+                        }
+                    }
+                    std::sort(dilated.begin(), dilated.end(), row_major);
+                    dilated.erase(std::unique(dilated.begin(), dilated.end()), dilated.end());
+                    auto& margin_offsets = table.margin_offsets[level * headings_ + heading];
+                    std::set_difference(dilated.begin(), dilated.end(), offsets.begin(), offsets.end(),
+                        std::back_inserter(margin_offsets), row_major);
+
+                    auto& bounds = table.bounds[level * headings_ + heading];
+                    for(const auto& offset : dilated)
+                    {
+                        bounds.min_x = std::min(bounds.min_x, offset.first);
+                        bounds.min_y = std::min(bounds.min_y, offset.second);
+                        bounds.max_x = std::max(bounds.max_x, offset.first);
+                        bounds.max_y = std::max(bounds.max_y, offset.second);
+                    }
+                }
+            }
+        }
+
+        updateIndices(table);
+    }
+
+    void ObstacleCostFunction::updateIndices(FootprintTable& table) const
+    {
+        table.size_x = costmap_->getSizeInCellsX();
+        table.indices.resize(table.offsets.size());
+        table.margin_indices.resize(table.margin_offsets.size());
+        for(unsigned int i = 0; i < table.offsets.size(); ++i)
+        {
+            table.indices[i].clear();
+            for(const auto& offset : table.offsets[i])
+            {
+                table.indices[i].push_back(offset.second * (int)table.size_x + offset.first);
+            }
+            table.margin_indices[i].clear();
+            for(const auto& offset : table.margin_offsets[i])
+            {
+                table.margin_indices[i].push_back(offset.second * (int)table.size_x + offset.first);
+            }
+        }
+    }
+
+    unsigned int ObstacleCostFunction::scalingLevel(const base_local_planner::Trajectory& traj) const
+    {
+        // same scaling factor as base_local_planner::ObstacleCostFunction::getScalingFactor, rounded up to a level
+        double vmag = hypot(traj.xv_, traj.yv_);
+        if(scaling_levels_ == 1 || vmag <= scaling_speed_ || max_trans_vel_ <= scaling_speed_)
+        {
+            return 0;
+        }
+        double ratio = std::min(1.0, (vmag - scaling_speed_) / (max_trans_vel_ - scaling_speed_));
+        return (unsigned int)ceil(ratio * (scaling_levels_ - 1));
+    }
+
+    double ObstacleCostFunction::levelScale(unsigned int level) const
+    {
+        return scaling_levels_ > 1 ? 1.0 + max_scaling_factor_ * level / (scaling_levels_ - 1) : 1.0;
+    }
+
+    double ObstacleCostFunction::footprintCost(const FootprintTable& table, double x, double y, double th,
+        unsigned int level) const
+    {
+        // same costs as base_local_planner::ObstacleCostFunction::footprintCost, which returns -6
+        // for any illegal footprint
+        unsigned int cell_x, cell_y;
+        if(!costmap_->worldToMap(x, y, cell_x, cell_y))
+        {
+            return -6.0;
+        }
+        const unsigned char* costs = costmap_->getCharMap();
+        unsigned int center = costmap_->getIndex(cell_x, cell_y);
+        unsigned char center_cost = costs[center];
+
+        if(table.footprint.size() < 3)
+        {
+            if(center_cost == costmap_2d::NO_INFORMATION || center_cost == costmap_2d::LETHAL_OBSTACLE ||
+                center_cost == costmap_2d::INSCRIBED_INFLATED_OBSTACLE)
+            {
+                return -6.0;
+            }
+            return center_cost;
+        }
+
+        int heading = (int)floor(th * headings_ / (2.0 * M_PI) + 0.5) % headings_;
+        if(heading < 0)
+        {
+            heading += headings_;
+        }
+        unsigned int i = level * headings_ + heading;
+
+        // near the map border, the exact footprint decides whether it is on the map, and without
+        // prepare (as in stop and rotate checks) the table may be for another costmap size
+        const CellBounds& bounds = table.bounds[i];
+        if(table.size_x != costmap_->getSizeInCellsX() || table.resolution != costmap_->getResolution() ||
+            (int)cell_x + bounds.min_x < 0 || (int)cell_y + bounds.min_y < 0 ||
+            (int)cell_x + bounds.max_x >= (int)costmap_->getSizeInCellsX() ||
+            (int)cell_y + bounds.max_y >= (int)costmap_->getSizeInCellsY())
+        {
+            return exactFootprintCost(table, x, y, th, level, center_cost);
+        }
+
+        auto is_lethal = [](unsigned char cost)
+        {
+            return cost == costmap_2d::NO_INFORMATION || cost == costmap_2d::LETHAL_OBSTACLE;
+        };
+        unsigned char footprint_cost = 0;
+        for(int offset : table.indices[i])
+        {
+            unsigned char cost = costs[center + offset];
+            if(is_lethal(cost))
+            {
+                return exactFootprintCost(table, x, y, th, level, center_cost);
+            }
+            footprint_cost = std::max(footprint_cost, cost);
+        }
+        for(int offset : table.margin_indices[i])
+        {
+            if(is_lethal(costs[center + offset]))
+            {
+                return exactFootprintCost(table, x, y, th, level, center_cost);
+            }
+        }
+
+        return std::max(footprint_cost, center_cost);
+    }
+
+    double ObstacleCostFunction::exactFootprintCost(const FootprintTable& table, double x, double y, double th,
+        unsigned int level, unsigned char center_cost) const
+    {
+        // same cells as base_local_planner::CostmapModel::footprintCost of the oriented, scaled footprint
+        double scale = levelScale(level);
+        double cos_th = cos(th), sin_th = sin(th);
+        auto vertex = [&](unsigned int i, unsigned int& map_x, unsigned int& map_y)
+        {
+            const auto& point = table.footprint[i];
+            double wx = x + scale * (point.x * cos_th - point.y * sin_th);
+            double wy = y + scale * (point.x * sin_th + point.y * cos_th);
+            return costmap_->worldToMap(wx, wy, map_x, map_y);
+        };
+
+        const unsigned char* costs = costmap_->getCharMap();
+        unsigned int n_points = table.footprint.size();
+        unsigned char footprint_cost = 0;
+        for(unsigned int i = 0; i < n_points; ++i)
+        {
+            unsigned int x0, y0, x1, y1;
+            if(!vertex(i, x0, y0) || !vertex((i + 1) % n_points, x1, y1))
+            {
+                return -6.0;
+            }
+            for(base_local_planner::LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance())
+            {
+                unsigned char cost = costs[costmap_->getIndex(line.getX(), line.getY())];
+                if(cost == costmap_2d::NO_INFORMATION || cost == costmap_2d::LETHAL_OBSTACLE)
+                {
+                    return -6.0;
+                }
+                footprint_cost = std::max(footprint_cost, cost);
+            }
+        }
+
+        return std::max(footprint_cost, center_cost);
+    }
+}
@@ -0,0 +1,347 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define RANGES_PER_WORKER 4 // granularity of work split, for stealing
+
+#include <hanp_local_planner/parallel_scored_sampling_planner.h>
+
+#include <ros/console.h>
+
+namespace hanp_local_planner
+{
+    ParallelScoredSamplingPlanner::ParallelScoredSamplingPlanner() : rollout_(NULL), fallback_critic_(NULL),
+        fallback_(NULL), bounded_(true), used_fallback_(false), best_cost_bound_(-1.0), fallback_cost_bound_(-1.0),
+        found_valid_(false), all_explored_(NULL), costs_(NULL), fallback_costs_(NULL) {}
+
+    void ParallelScoredSamplingPlanner::initialize(BatchRollout* rollout,
+        std::vector<base_local_planner::TrajectoryCostFunction*>& critics, unsigned int threads)
+    {
+        rollout_ = rollout;
+        critics_ = critics;
+
+        pool_.resize(threads);
+        workers_.resize(pool_.size());
+        ROS_INFO_NAMED("parallel_scored_sampling_planner", "scoring trajectories with %u threads", pool_.size());
+    }
+
+    void ParallelScoredSamplingPlanner::setFallbackCritic(base_local_planner::TrajectoryCostFunction* critic,
+        base_local_planner::TrajectoryCostFunction* fallback)
+    {
+        fallback_critic_ = critic;
+        fallback_ = fallback;
+    }
+
+    double ParallelScoredSamplingPlanner::scoreTrajectory(base_local_planner::Trajectory& traj, double best_traj_cost)
+    {
+        return scoreTrajectory(traj, best_traj_cost, -1.0, NULL);
+    }
+
+    double ParallelScoredSamplingPlanner::scoreTrajectory(base_local_planner::Trajectory& traj, double best_traj_cost,
+        double best_fallback_cost, double* fallback_cost)
+    {
+        bool score_fallback = fallback_ && fallback_cost;
+        if(fallback_cost)
+        {
+            *fallback_cost = -1.0;
+        }
+
+        double traj_cost = 0, critic_cost = 0;
+        bool fallback = false;
+        for(auto critic : critics_)
+        {
+            if(critic->getScale() == 0)
+            {
+                continue;
+            }
+            double cost = critic->scoreTrajectory(traj);
+            if(cost < 0 && score_fallback && critic == fallback_critic_)
+            {
+                // other critics do not depend on the fallback, continue summing with it in place
+                critic_cost = cost;
+                fallback = true;
+                critic = fallback_;
+                cost = critic->scoreTrajectory(traj);
+            }
+            if(cost < 0)
+            {
+                traj_cost = cost;
+                break;
+            }
+            if(cost != 0)
+            {
+                cost *= critic->getScale();
+            }
+            traj_cost += cost;
+            double bound = fallback ? best_fallback_cost : best_traj_cost;
+            if(bound > 0 && traj_cost > bound)
+            {
+                // cannot become the best trajectory any more
+                break;
+            }
+        }
+
+        if(fallback)
+        {
+            *fallback_cost = traj_cost;
+            return critic_cost;
+        }
+        return traj_cost;
+    }
+
+    bool ParallelScoredSamplingPlanner::prepare()
+    {
+        for(auto critic : critics_)
+        {
+            if(!critic->prepare())
+            {
+                ROS_WARN("A scoring function failed to prepare");
+                return false;
+            }
+        }
+        if(fallback_ && !fallback_->prepare())
+        {
+            ROS_WARN("A scoring function failed to prepare");
+            return false;
+        }
+        return true;
+    }
+
+    void ParallelScoredSamplingPlanner::scoreAllSamples(std::vector<double>& costs,
+        std::vector<double>& fallback_costs)
+    {
+        unsigned int n_samples = rollout_->size();
+        costs.resize(n_samples);
+        fallback_costs.resize(n_samples);
+        costs_ = &costs;
+        fallback_costs_ = &fallback_costs;
+
+        unsigned int grain = n_samples / (pool_.size() * RANGES_PER_WORKER) + 1;
+        pool_.parallelFor(n_samples, grain, boost::bind(&ParallelScoredSamplingPlanner::scoreSamplesUnbounded,
+            this, _1, _2, _3));
+
+        costs_ = NULL;
+        fallback_costs_ = NULL;
+    }
+
+    bool ParallelScoredSamplingPlanner::findBestTrajectory(base_local_planner::Trajectory& traj,
+        std::vector<base_local_planner::Trajectory>* all_explored)
+    {
+        return findBestTrajectory(traj, all_explored, rollout_->size());
+    }
+
+    bool ParallelScoredSamplingPlanner::findBestTrajectory(base_local_planner::Trajectory& traj,
+        std::vector<base_local_planner::Trajectory>* all_explored, unsigned int seed)
+    {
+        if(!prepare())
+        {
+            return false;
+        }
+
+        unsigned int n_samples = rollout_->size();
+        for(auto& worker : workers_)
+        {
+            worker.best_cost = -1.0;
+            worker.best_index = n_samples;
+            worker.fallback_cost = -1.0;
+            worker.fallback_index = n_samples;
+        }
+        best_cost_bound_ = -1.0;
+        fallback_cost_bound_ = -1.0;
+        found_valid_ = false;
+
+        // the seed is one of the samples, so its exact cost is an upper bound of the best cost,
+        // and partial costs of all samples at least as good as the best one never exceed it
+        if(bounded_ && seed < n_samples && rollout_->getTrajectory(seed, workers_[0].loop_traj))
+        {
+            double fallback_cost;
+            double cost = scoreTrajectory(workers_[0].loop_traj, -1.0, -1.0, &fallback_cost);
+            if(cost > 0)
+            {
+                best_cost_bound_ = cost;
+            }
+            if(fallback_cost > 0)
+            {
+                fallback_cost_bound_ = fallback_cost;
+            }
+        }
+
+        all_explored_ = all_explored;
+        if(all_explored_)
+        {
+            all_explored_->resize(n_samples);
+            explored_valid_.assign(n_samples, 0);
+        }
+
+        unsigned int grain = n_samples / (pool_.size() * RANGES_PER_WORKER) + 1;
+        pool_.parallelFor(n_samples, grain, boost::bind(&ParallelScoredSamplingPlanner::scoreSamples, this, _1, _2, _3));
+
+        // reduce in sample order, so that ties are resolved as in sequential search
+        Worker* best = NULL;
+        for(auto& worker : workers_)
+        {
+            if(worker.best_cost < 0)
+            {
+                continue;
+            }
+            if(!best || worker.best_cost < best->best_cost ||
+                (worker.best_cost == best->best_cost && worker.best_index < best->best_index))
+            {
+                best = &worker;
+            }
+        }
+
+        used_fallback_ = false;
+        if(!best)
+        {
+            for(auto& worker : workers_)
+            {
+                if(worker.fallback_cost < 0)
+                {
+                    continue;
+                }
+                if(!best || worker.fallback_cost < best->fallback_cost ||
+                    (worker.fallback_cost == best->fallback_cost && worker.fallback_index < best->fallback_index))
+                {
+                    best = &worker;
+                }
+            }
+            if(best)
+            {
+                used_fallback_ = true;
+                std::swap(best->best_traj, best->fallback_traj);
+                best->best_cost = best->fallback_cost;
+            }
+        }
+
+        if(all_explored_)
+        {
+            // drop samples for which no trajectory could be generated
+            unsigned int n_explored = 0;
+            for(unsigned int i = 0; i < explored_valid_.size(); ++i)
+            {
+                if(explored_valid_[i])
+                {
+                    if(n_explored != i)
+                    {
+                        std::swap((*all_explored_)[n_explored], (*all_explored_)[i]);
+                    }
+                    ++n_explored;
+                }
+            }
+            all_explored_->resize(n_explored);
+            all_explored_ = NULL;
+        }
+
+        if(!best)
+        {
+            ROS_DEBUG("Evaluated %u trajectories, found no valid one", n_samples);
+            return false;
+        }
+
+        traj.xv_ = best->best_traj.xv_;
+        traj.yv_ = best->best_traj.yv_;
+        traj.thetav_ = best->best_traj.thetav_;
+        traj.cost_ = best->best_cost;
+        traj.resetPoints();
+        double px, py, pth;
+        for(unsigned int i = 0; i < best->best_traj.getPointsSize(); ++i)
+        {
+            best->best_traj.getPoint(i, px, py, pth);
+            traj.addPoint(px, py, pth);
+        }
+        ROS_DEBUG("Evaluated %u trajectories, best cost %f (%f, %f, %f)", n_samples,
+            traj.cost_, traj.xv_, traj.yv_, traj.thetav_);
+        return true;
+    }
+
+    void ParallelScoredSamplingPlanner::scoreSamples(unsigned int worker_index, unsigned int begin, unsigned int end)
+    {
+        auto& worker = workers_[worker_index];
+        for(unsigned int i = begin; i < end; ++i)
+        {
+            // scratch trajectory keeps its point storage across samples and cycles
+            if(!rollout_->getTrajectory(i, worker.loop_traj))
+            {
+                continue;
+            }
+
+            // best cost found by any worker bounds the scoring
+            double bound = bounded_ ? best_cost_bound_.load() : -1.0;
+            double fallback_bound = bounded_ ? fallback_cost_bound_.load() : -1.0;
+            double fallback_cost = -1.0;
+            double cost = scoreTrajectory(worker.loop_traj, bound, fallback_bound,
+                found_valid_ ? NULL : &fallback_cost);
+
+            if(all_explored_)
+            {
+                worker.loop_traj.cost_ = cost;
+                (*all_explored_)[i] = worker.loop_traj;
+                explored_valid_[i] = 1;
+            }
+
+            if(cost >= 0 && (worker.best_cost < 0 || cost < worker.best_cost ||
+                (cost == worker.best_cost && i < worker.best_index)))
+            {
+                worker.best_cost = cost;
+                worker.best_index = i;
+                worker.best_traj = worker.loop_traj;
+                updateBound(best_cost_bound_, cost);
+                found_valid_ = true;
+            }
+            else if(fallback_cost >= 0 && (worker.fallback_cost < 0 || fallback_cost < worker.fallback_cost ||
+                (fallback_cost == worker.fallback_cost && i < worker.fallback_index)))
+            {
+                worker.fallback_cost = fallback_cost;
+                worker.fallback_index = i;
+                worker.fallback_traj = worker.loop_traj;
+                updateBound(fallback_cost_bound_, fallback_cost);
+            }
+        }
+    }
+
+    void ParallelScoredSamplingPlanner::scoreSamplesUnbounded(unsigned int worker_index, unsigned int begin,
+        unsigned int end)
+    {
+        auto& worker = workers_[worker_index];
+        for(unsigned int i = begin; i < end; ++i)
+        {
+            if(!rollout_->getTrajectory(i, worker.loop_traj))
+            {
+                (*costs_)[i] = -1.0;
+                (*fallback_costs_)[i] = -1.0;
+                continue;
+            }
+            (*costs_)[i] = scoreTrajectory(worker.loop_traj, -1.0, -1.0, &(*fallback_costs_)[i]);
+        }
+    }
+
+    void ParallelScoredSamplingPlanner::updateBound(std::atomic<double>& bound, double cost)
+    {
+        double current = bound.load();
+        while((current < 0 || cost < current) && !bound.compare_exchange_weak(current, cost)) {}
+    }
+}
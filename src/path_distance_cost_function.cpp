@@ -0,0 +1,122 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/path_distance_cost_function.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <ros/console.h>
+
+namespace hanp_local_planner
+{
+    PathDistanceCostFunction::PathDistanceCostFunction(costmap_2d::Costmap2D* costmap, double xshift, double yshift,
+        bool is_local_goal_function) : costmap_(costmap), grid_(is_local_goal_function), xshift_(xshift),
+        yshift_(yshift), stop_on_failure_(true), region_center_x_(0.0), region_center_y_(0.0), region_radius_(0.0) {}
+
+    void PathDistanceCostFunction::setTargetPoses(const std::vector<geometry_msgs::PoseStamped>& target_poses)
+    {
+        target_poses_.assign(target_poses.begin(), target_poses.end());
+    }
+
+    void PathDistanceCostFunction::setRegionOfInterest(double center_x, double center_y, double radius)
+    {
+        region_center_x_ = center_x;
+        region_center_y_ = center_y;
+        region_radius_ = radius;
+    }
+
+    bool PathDistanceCostFunction::prepare()
+    {
+        unsigned int region_x = 0, region_y = 0;
+        unsigned int size_x = costmap_->getSizeInCellsX(), size_y = costmap_->getSizeInCellsY();
+        if(region_radius_ > 0.0)
+        {
+            // scored points are shifted from the trajectory, region is kept at same size
+            // near costmap borders, so that the grid can still be shifted instead of reset
+            double radius = region_radius_ + fabs(xshift_) + fabs(yshift_);
+            unsigned int cells = 2 * (unsigned int)ceil(radius / costmap_->getResolution()) + 1;
+            size_x = std::min(cells, size_x);
+            size_y = std::min(cells, size_y);
+
+            int center_x, center_y;
+            costmap_->worldToMapNoBounds(region_center_x_, region_center_y_, center_x, center_y);
+            region_x = std::min(std::max(center_x - (int)size_x / 2, 0), (int)(costmap_->getSizeInCellsX() - size_x));
+            region_y = std::min(std::max(center_y - (int)size_y / 2, 0), (int)(costmap_->getSizeInCellsY() - size_y));
+        }
+
+        grid_.update(*costmap_, target_poses_, region_x, region_y, size_x, size_y);
+        return true;
+    }
+
+    double PathDistanceCostFunction::scoreTrajectory(base_local_planner::Trajectory &traj)
+    {
+        double cost = 0.0;
+        double px, py, pth;
+        unsigned int cell_x, cell_y;
+
+        for(unsigned int i = 0; i < traj.getPointsSize(); ++i)
+        {
+            traj.getPoint(i, px, py, pth);
+
+            // translate point forward and sideways if specified
+            if(xshift_ != 0.0)
+            {
+                px = px + xshift_ * cos(pth);
+                py = py + xshift_ * sin(pth);
+            }
+            if(yshift_ != 0.0)
+            {
+                px = px + yshift_ * cos(pth + M_PI_2);
+                py = py + yshift_ * sin(pth + M_PI_2);
+            }
+
+            // trajectories going off the map are not allowed
+            if(!costmap_->worldToMap(px, py, cell_x, cell_y))
+            {
+                ROS_WARN("Off Map %f, %f", px, py);
+                return -4.0;
+            }
+
+            double grid_dist = grid_.getCellCosts(cell_x, cell_y);
+            if(stop_on_failure_)
+            {
+                if(grid_dist == grid_.obstacleCosts())
+                {
+                    return -3.0;
+                }
+                else if(grid_dist == grid_.unreachableCellCosts())
+                {
+                    return -2.0;
+                }
+            }
+            cost = grid_dist;
+        }
+
+        return cost;
+    }
+}
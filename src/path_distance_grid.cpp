@@ -0,0 +1,582 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/path_distance_grid.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include <ros/console.h>
+#include <costmap_2d/cost_values.h>
+
+namespace hanp_local_planner
+{
+    // cells that stop the wavefront, as in MapGrid::updatePathCell
+    static inline bool isBlocked(unsigned char cost)
+    {
+        return cost == costmap_2d::LETHAL_OBSTACLE ||
+            cost == costmap_2d::INSCRIBED_INFLATED_OBSTACLE ||
+            cost == costmap_2d::NO_INFORMATION;
+    }
+
+    const unsigned int PathDistanceGrid::UNREACHED;
+    const unsigned char PathDistanceGrid::BLOCKED;
+
+    PathDistanceGrid::PathDistanceGrid(bool is_local_goal_grid) : is_local_goal_grid_(is_local_goal_grid),
+        map_size_(0), region_x_(0), region_y_(0), size_x_(0), size_y_(0), resolution_(0.0), origin_x_(0.0),
+        origin_y_(0.0), initialized_(false), highest_bucket_(0), updated_cells_(0) {}
+
+    void PathDistanceGrid::update(const costmap_2d::Costmap2D& costmap,
+        const std::vector<geometry_msgs::PoseStamped>& plan,
+        unsigned int region_x, unsigned int region_y, unsigned int region_size_x, unsigned int region_size_y)
+    {
+        updated_cells_ = 0;
+        raise_queue_.clear();
+        pull_cells_.clear();
+
+        map_size_ = costmap.getSizeInCellsX() * costmap.getSizeInCellsY();
+        region_x = std::min(region_x, costmap.getSizeInCellsX() - 1);
+        region_y = std::min(region_y, costmap.getSizeInCellsY() - 1);
+        region_size_x = std::max(1u, std::min(region_size_x, costmap.getSizeInCellsX() - region_x));
+        region_size_y = std::max(1u, std::min(region_size_y, costmap.getSizeInCellsY() - region_y));
+
+        // plan cells are found before the region is placed, a region that no plan
+        // cell can seed falls back to the whole costmap
+        findTargetCells(costmap, plan);
+        if(!canSeed(costmap, region_x, region_y, region_size_x, region_size_y))
+        {
+            ROS_DEBUG_NAMED("path_distance_grid", "no plan cell can seed the region, using the whole costmap");
+            region_x = 0;
+            region_y = 0;
+            region_size_x = costmap.getSizeInCellsX();
+            region_size_y = costmap.getSizeInCellsY();
+        }
+        double origin_x = costmap.getOriginX() + region_x * costmap.getResolution();
+        double origin_y = costmap.getOriginY() + region_y * costmap.getResolution();
+
+        // rolling window or robot motion moves the region by whole cells
+        int shift_x = 0, shift_y = 0;
+        bool same_grid = initialized_ && region_size_x == size_x_ && region_size_y == size_y_ &&
+            costmap.getResolution() == resolution_;
+        if(same_grid)
+        {
+            shift_x = (int)lround((origin_x - origin_x_) / resolution_);
+            shift_y = (int)lround((origin_y - origin_y_) / resolution_);
+        }
+        region_x_ = region_x;
+        region_y_ = region_y;
+        if(!same_grid || (unsigned int)std::abs(shift_x) >= size_x_ || (unsigned int)std::abs(shift_y) >= size_y_)
+        {
+            reset(costmap, region_size_x, region_size_y);
+        }
+        else if(shift_x != 0 || shift_y != 0)
+        {
+            shift(shift_x, shift_y);
+        }
+        origin_x_ = origin_x;
+        origin_y_ = origin_y;
+
+        // first invalidate everything that may have got longer, then shorten
+        updateBlockedCells(costmap);
+        updateTargetCells();
+        raise(0, 0, size_x_, size_y_);
+
+        for(auto index : pull_cells_)
+        {
+            if(!isExpanding(index))
+            {
+                continue;
+            }
+
+            unsigned int x = index % size_x_, y = index / size_x_;
+            unsigned int best = seed_[index];
+            if(x > 0 && dist_[index - 1] != UNREACHED) best = std::min(best, dist_[index - 1] + 1);
+            if(x < size_x_ - 1 && dist_[index + 1] != UNREACHED) best = std::min(best, dist_[index + 1] + 1);
+            if(y > 0 && dist_[index - size_x_] != UNREACHED) best = std::min(best, dist_[index - size_x_] + 1);
+            if(y < size_y_ - 1 && dist_[index + size_x_] != UNREACHED) best = std::min(best, dist_[index + size_x_] + 1);
+
+            if(best < dist_[index])
+            {
+                dist_[index] = best;
+                push(index, best);
+            }
+        }
+        lower();
+
+        ROS_DEBUG_NAMED("path_distance_grid", "updated %u of %u cells, region shifted by (%d, %d)",
+            updated_cells_, size_x_ * size_y_, shift_x, shift_y);
+    }
+
+    double PathDistanceGrid::getCellCosts(unsigned int map_x, unsigned int map_y) const
+    {
+        if(map_x < region_x_ || map_y < region_y_ || map_x - region_x_ >= size_x_ || map_y - region_y_ >= size_y_)
+        {
+            return unreachableCellCosts();
+        }
+
+        unsigned int cx = map_x - region_x_, cy = map_y - region_y_;
+        unsigned int index = cy * size_x_ + cx;
+        if(dist_[index] != UNREACHED)
+        {
+            return dist_[index];
+        }
+
+        // MapGrid marks obstacles only when the wavefront reaches them
+        if(flags_[index] & BLOCKED)
+        {
+            if((cx > 0 && dist_[index - 1] != UNREACHED) ||
+                (cx < size_x_ - 1 && dist_[index + 1] != UNREACHED) ||
+                (cy > 0 && dist_[index - size_x_] != UNREACHED) ||
+                (cy < size_y_ - 1 && dist_[index + size_x_] != UNREACHED))
+            {
+                return obstacleCosts();
+            }
+        }
+        return unreachableCellCosts();
+    }
+
+    void PathDistanceGrid::copyCellCosts(std::vector<float>& costs, unsigned int map_size_x,
+        unsigned int map_size_y) const
+    {
+        costs.assign(map_size_x * map_size_y, unreachableCellCosts());
+        if(!initialized_)
+        {
+            return;
+        }
+
+        unsigned int end_x = std::min(region_x_ + size_x_, map_size_x);
+        unsigned int end_y = std::min(region_y_ + size_y_, map_size_y);
+        for(unsigned int map_y = region_y_; map_y < end_y; ++map_y)
+        {
+            float* row = &costs[map_y * map_size_x];
+            const unsigned int* dist = &dist_[(map_y - region_y_) * size_x_];
+            for(unsigned int map_x = region_x_; map_x < end_x; ++map_x)
+            {
+                unsigned int cx = map_x - region_x_;
+                row[map_x] = dist[cx] != UNREACHED ? dist[cx] : getCellCosts(map_x, map_y);
+            }
+        }
+    }
+
+    void PathDistanceGrid::reset(const costmap_2d::Costmap2D& costmap, unsigned int size_x, unsigned int size_y)
+    {
+        size_x_ = size_x;
+        size_y_ = size_y;
+        resolution_ = costmap.getResolution();
+
+        // blocked cells are found when comparing with the costmap
+        dist_.assign(size_x_ * size_y_, UNREACHED);
+        seed_.assign(size_x_ * size_y_, UNREACHED);
+        flags_.assign(size_x_ * size_y_, BLOCKED);
+        targets_.clear();
+
+        initialized_ = true;
+        ROS_DEBUG_NAMED("path_distance_grid", "reset path distance grid to %u x %u cells", size_x_, size_y_);
+    }
+
+    void PathDistanceGrid::shift(int shift_x, int shift_y)
+    {
+        // part of the old grid that stays in the window, in old cell coordinates
+        unsigned int min_x = std::max(shift_x, 0), max_x = std::min((int)size_x_ + shift_x, (int)size_x_);
+        unsigned int min_y = std::max(shift_y, 0), max_y = std::min((int)size_y_ + shift_y, (int)size_y_);
+
+        // cells that got their distance through cells leaving the window
+        auto check_edge = [this](unsigned int kept, unsigned int leaving)
+        {
+            if(dist_[leaving] != UNREACHED && dist_[kept] == dist_[leaving] + 1 && dist_[kept] != seed_[kept])
+            {
+                invalidate(kept);
+            }
+        };
+        for(unsigned int y = min_y; y < max_y; ++y)
+        {
+            if(min_x > 0) check_edge(y * size_x_ + min_x, y * size_x_ + min_x - 1);
+            if(max_x < size_x_) check_edge(y * size_x_ + max_x - 1, y * size_x_ + max_x);
+        }
+        for(unsigned int x = min_x; x < max_x; ++x)
+        {
+            if(min_y > 0) check_edge(min_y * size_x_ + x, (min_y - 1) * size_x_ + x);
+            if(max_y < size_y_) check_edge((max_y - 1) * size_x_ + x, max_y * size_x_ + x);
+        }
+        raise(min_x, min_y, max_x, max_y);
+
+        // cells entering the window are unknown until compared with the costmap
+        shift_dist_.assign(dist_.size(), UNREACHED);
+        shift_seed_.assign(seed_.size(), UNREACHED);
+        shift_flags_.assign(flags_.size(), BLOCKED);
+        for(unsigned int y = min_y; y < max_y; ++y)
+        {
+            unsigned int from = y * size_x_ + min_x;
+            unsigned int to = (y - shift_y) * size_x_ + (min_x - shift_x);
+            std::copy(dist_.begin() + from, dist_.begin() + from + (max_x - min_x), shift_dist_.begin() + to);
+            std::copy(seed_.begin() + from, seed_.begin() + from + (max_x - min_x), shift_seed_.begin() + to);
+            std::copy(flags_.begin() + from, flags_.begin() + from + (max_x - min_x), shift_flags_.begin() + to);
+        }
+        dist_.swap(shift_dist_);
+        seed_.swap(shift_seed_);
+        flags_.swap(shift_flags_);
+
+        // order of cells is kept, so lists stay sorted
+        auto move_cell = [&](unsigned int& index)
+        {
+            unsigned int x = index % size_x_, y = index / size_x_;
+            if(x >= min_x && x < max_x && y >= min_y && y < max_y)
+            {
+                index = (y - shift_y) * size_x_ + (x - shift_x);
+                return true;
+            }
+            return false;
+        };
+        unsigned int kept = 0;
+        for(auto target : targets_)
+        {
+            if(move_cell(target.first))
+            {
+                targets_[kept++] = target;
+            }
+        }
+        targets_.resize(kept);
+        kept = 0;
+        for(auto index : pull_cells_)
+        {
+            if(move_cell(index))
+            {
+                pull_cells_[kept++] = index;
+            }
+        }
+        pull_cells_.resize(kept);
+    }
+
+    void PathDistanceGrid::updateBlockedCells(const costmap_2d::Costmap2D& costmap)
+    {
+        const unsigned char* costs = costmap.getCharMap();
+        for(unsigned int y = 0; y < size_y_; ++y)
+        {
+            const unsigned char* row_costs = costs + (region_y_ + y) * costmap.getSizeInCellsX() + region_x_;
+            for(unsigned int x = 0, index = y * size_x_; x < size_x_; ++x, ++index)
+            {
+                bool blocked = isBlocked(row_costs[x]);
+                if(blocked == ((flags_[index] & BLOCKED) != 0))
+                {
+                    continue;
+                }
+
+                if(blocked)
+                {
+                    flags_[index] |= BLOCKED;
+                    if(seed_[index] == UNREACHED)
+                    {
+                        invalidate(index);
+                    }
+                }
+                else
+                {
+                    flags_[index] &= ~BLOCKED;
+                    pull_cells_.push_back(index);
+                }
+            }
+        }
+    }
+
+    void PathDistanceGrid::updateTargetCells()
+    {
+        findSeedCells();
+
+        // targets whose seed changed are recomputed after raising
+        auto change_seed = [this](unsigned int index, unsigned int seed)
+        {
+            invalidate(index);
+            seed_[index] = seed;
+            pull_cells_.push_back(index);
+        };
+        auto old_target = targets_.begin();
+        auto new_target = new_targets_.begin();
+        while(old_target != targets_.end() || new_target != new_targets_.end())
+        {
+            if(new_target == new_targets_.end() ||
+                (old_target != targets_.end() && old_target->first < new_target->first))
+            {
+                change_seed(old_target->first, UNREACHED);
+                ++old_target;
+            }
+            else if(old_target == targets_.end() || new_target->first < old_target->first)
+            {
+                change_seed(new_target->first, new_target->second);
+                ++new_target;
+            }
+            else
+            {
+                if(old_target->second != new_target->second)
+                {
+                    change_seed(new_target->first, new_target->second);
+                }
+                ++old_target;
+                ++new_target;
+            }
+        }
+        targets_.swap(new_targets_);
+    }
+
+    void PathDistanceGrid::findTargetCells(const costmap_2d::Costmap2D& costmap,
+        const std::vector<geometry_msgs::PoseStamped>& plan)
+    {
+        plan_cells_.clear();
+        double resolution = costmap.getResolution();
+
+        // same points as MapGrid::adjustPlanResolution, up to where plan leaves the costmap
+        bool started_path = false;
+        unsigned int goal_x = 0, goal_y = 0;
+        auto add_point = [&](double x, double y)
+        {
+            unsigned int map_x, map_y;
+            if(costmap.worldToMap(x, y, map_x, map_y) && costmap.getCost(map_x, map_y) != costmap_2d::NO_INFORMATION)
+            {
+                goal_x = map_x;
+                goal_y = map_y;
+                if(!is_local_goal_grid_)
+                {
+                    plan_cells_.push_back(std::make_pair(map_x, map_y));
+                }
+                started_path = true;
+                return true;
+            }
+            return !started_path;
+        };
+
+        if(!plan.empty())
+        {
+            double last_x = plan[0].pose.position.x, last_y = plan[0].pose.position.y;
+            bool in_map = add_point(last_x, last_y);
+            double min_sq_resolution = resolution * resolution;
+            for(unsigned int i = 1; in_map && i < plan.size(); ++i)
+            {
+                double loop_x = plan[i].pose.position.x, loop_y = plan[i].pose.position.y;
+                double sq_dist = (loop_x - last_x) * (loop_x - last_x) + (loop_y - last_y) * (loop_y - last_y);
+                if(sq_dist > min_sq_resolution)
+                {
+                    int steps = ceil(sqrt(sq_dist) / resolution);
+                    double delta_x = (loop_x - last_x) / steps, delta_y = (loop_y - last_y) / steps;
+                    for(int j = 1; in_map && j < steps; ++j)
+                    {
+                        in_map = add_point(last_x + j * delta_x, last_y + j * delta_y);
+                    }
+                }
+                in_map = in_map && add_point(loop_x, loop_y);
+                last_x = loop_x;
+                last_y = loop_y;
+            }
+        }
+
+        if(!started_path)
+        {
+            ROS_ERROR("None of the %zu points of the global plan were in the local costmap and free", plan.size());
+            return;
+        }
+
+        if(is_local_goal_grid_)
+        {
+            plan_cells_.push_back(std::make_pair(goal_x, goal_y));
+        }
+    }
+
+    bool PathDistanceGrid::canSeed(const costmap_2d::Costmap2D& costmap, unsigned int region_x, unsigned int region_y,
+        unsigned int region_size_x, unsigned int region_size_y) const
+    {
+        if(plan_cells_.empty())
+        {
+            return true;
+        }
+        for(const auto& cell : plan_cells_)
+        {
+            if(cell.first >= region_x && cell.second >= region_y &&
+                cell.first - region_x < region_size_x && cell.second - region_y < region_size_y)
+            {
+                return true;
+            }
+        }
+
+        // all plan cells are outside, one free border cell is enough
+        const unsigned char* costs = costmap.getCharMap();
+        unsigned int map_size_x = costmap.getSizeInCellsX();
+        unsigned int max_x = region_x + region_size_x - 1, max_y = region_y + region_size_y - 1;
+        for(unsigned int x = region_x; x <= max_x; ++x)
+        {
+            if(!isBlocked(costs[region_y * map_size_x + x]) || !isBlocked(costs[max_y * map_size_x + x]))
+            {
+                return true;
+            }
+        }
+        for(unsigned int y = region_y; y <= max_y; ++y)
+        {
+            if(!isBlocked(costs[y * map_size_x + region_x]) || !isBlocked(costs[y * map_size_x + max_x]))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void PathDistanceGrid::findSeedCells()
+    {
+        new_targets_.clear();
+        outside_cells_.clear();
+
+        for(const auto& cell : plan_cells_)
+        {
+            int x = (int)cell.first - (int)region_x_, y = (int)cell.second - (int)region_y_;
+            if(x >= 0 && y >= 0 && x < (int)size_x_ && y < (int)size_y_)
+            {
+                new_targets_.push_back(std::make_pair(y * size_x_ + x, 0u));
+            }
+            else
+            {
+                outside_cells_.push_back(std::make_pair(x, y));
+            }
+        }
+
+        // plan cells outside the region seed every free border cell with their manhattan
+        // distance, a lower bound of the distance around obstacles outside the region
+        if(!outside_cells_.empty())
+        {
+            auto add_border_cell = [this](unsigned int x, unsigned int y)
+            {
+                unsigned int index = y * size_x_ + x;
+                if(flags_[index] & BLOCKED)
+                {
+                    return;
+                }
+                unsigned int seed = UNREACHED;
+                for(const auto& cell : outside_cells_)
+                {
+                    seed = std::min(seed, (unsigned int)(std::abs(cell.first - (int)x) + std::abs(cell.second - (int)y)));
+                }
+                new_targets_.push_back(std::make_pair(index, seed));
+            };
+            for(unsigned int x = 0; x < size_x_; ++x)
+            {
+                add_border_cell(x, 0);
+                if(size_y_ > 1) add_border_cell(x, size_y_ - 1);
+            }
+            for(unsigned int y = 1; y + 1 < size_y_; ++y)
+            {
+                add_border_cell(0, y);
+                if(size_x_ > 1) add_border_cell(size_x_ - 1, y);
+            }
+        }
+
+        // keep lowest seed of every cell
+        std::sort(new_targets_.begin(), new_targets_.end());
+        new_targets_.erase(std::unique(new_targets_.begin(), new_targets_.end(),
+            [](const std::pair<unsigned int, unsigned int>& a, const std::pair<unsigned int, unsigned int>& b)
+            {
+                return a.first == b.first;
+            }), new_targets_.end());
+    }
+
+    void PathDistanceGrid::invalidate(unsigned int index)
+    {
+        if(dist_[index] != UNREACHED)
+        {
+            raise_queue_.push_back(std::make_pair(index, dist_[index]));
+            dist_[index] = UNREACHED;
+            pull_cells_.push_back(index);
+        }
+    }
+
+    void PathDistanceGrid::raise(unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y)
+    {
+        // invalidate every cell that may have got its distance through an invalidated cell
+        for(unsigned int i = 0; i < raise_queue_.size(); ++i)
+        {
+            unsigned int index = raise_queue_[i].first;
+            unsigned int next_dist = raise_queue_[i].second + 1;
+            unsigned int x = index % size_x_, y = index / size_x_;
+
+            unsigned int neighbours[4], n_neighbours = 0;
+            if(x > min_x) neighbours[n_neighbours++] = index - 1;
+            if(x + 1 < max_x) neighbours[n_neighbours++] = index + 1;
+            if(y > min_y) neighbours[n_neighbours++] = index - size_x_;
+            if(y + 1 < max_y) neighbours[n_neighbours++] = index + size_x_;
+
+            for(unsigned int n = 0; n < n_neighbours; ++n)
+            {
+                if(dist_[neighbours[n]] == next_dist && seed_[neighbours[n]] != next_dist)
+                {
+                    invalidate(neighbours[n]);
+                }
+            }
+        }
+        raise_queue_.clear();
+    }
+
+    void PathDistanceGrid::lower()
+    {
+        // buckets are visited in increasing distance, like the fifo in MapGrid
+        for(unsigned int dist = 0; dist <= highest_bucket_ && dist < buckets_.size(); ++dist)
+        {
+            for(unsigned int i = 0; i < buckets_[dist].size(); ++i)
+            {
+                unsigned int index = buckets_[dist][i];
+                if(dist_[index] != dist)
+                {
+                    continue;
+                }
+
+                unsigned int x = index % size_x_, y = index / size_x_;
+                unsigned int neighbours[4], n_neighbours = 0;
+                if(x > 0) neighbours[n_neighbours++] = index - 1;
+                if(x < size_x_ - 1) neighbours[n_neighbours++] = index + 1;
+                if(y > 0) neighbours[n_neighbours++] = index - size_x_;
+                if(y < size_y_ - 1) neighbours[n_neighbours++] = index + size_x_;
+
+                for(unsigned int n = 0; n < n_neighbours; ++n)
+                {
+                    auto neighbour = neighbours[n];
+                    if(isExpanding(neighbour) && dist + 1 < dist_[neighbour])
+                    {
+                        dist_[neighbour] = dist + 1;
+                        push(neighbour, dist + 1);
+                    }
+                }
+            }
+            buckets_[dist].clear();
+        }
+        highest_bucket_ = 0;
+    }
+
+    void PathDistanceGrid::push(unsigned int index, unsigned int dist)
+    {
+        if(buckets_.size() <= dist)
+        {
+            buckets_.resize(dist + 1);
+        }
+        buckets_[dist].push_back(index);
+        highest_bucket_ = std::max(highest_bucket_, dist);
+        ++updated_cells_;
+    }
+}
@@ -0,0 +1,168 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/plan_publisher.h>
+
+#define MAX_GLOBAL_RATE 5.0 // Hz, default maximum rate of published global plans
+
+namespace hanp_local_planner
+{
+    PlanPublisher::PlanPublisher() : publish_thread_(NULL), local_queued_(false),
+        min_global_period_(1.0 / MAX_GLOBAL_RATE) {}
+
+    PlanPublisher::~PlanPublisher()
+    {
+        if(publish_thread_)
+        {
+            publish_thread_->interrupt();
+            publish_thread_->join();
+            delete publish_thread_;
+        }
+    }
+
+    void PlanPublisher::initialize(ros::NodeHandle& nh)
+    {
+        global_pub_ = nh.advertise<nav_msgs::Path>("global_plan", 1);
+        local_pub_ = nh.advertise<nav_msgs::Path>("local_plan", 1);
+
+        if(!publish_thread_)
+        {
+            publish_thread_ = new boost::thread(boost::bind(&PlanPublisher::publishThread, this));
+        }
+    }
+
+    void PlanPublisher::setParams(double max_global_rate)
+    {
+        min_global_period_ = max_global_rate > 0.0 ? 1.0 / max_global_rate : 1.0 / MAX_GLOBAL_RATE;
+    }
+
+    void PlanPublisher::publishLocalPlan()
+    {
+        if(!publish_thread_)
+        {
+            return;
+        }
+
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            std::swap(local_back_, local_pending_);
+            local_queued_ = true;
+        }
+        queued_.notify_one();
+    }
+
+    void PlanPublisher::publishGlobalPlan(const std::vector<geometry_msgs::PoseStamped>& path)
+    {
+        if(!publish_thread_ || path.empty() || global_pub_.getNumSubscribers() == 0)
+        {
+            return;
+        }
+
+        // a changed plan skipped here is still different next cycle, so the latest one gets out
+        auto now = ros::WallTime::now();
+        if((now - last_global_publish_).toSec() < min_global_period_.load() || samePlan(path))
+        {
+            return;
+        }
+        last_global_publish_ = now;
+
+        boost::shared_ptr<nav_msgs::Path> plan(new nav_msgs::Path());
+        plan->header.frame_id = path[0].header.frame_id;
+        plan->header.stamp = path[0].header.stamp;
+        plan->poses = path;
+        global_last_ = plan;
+
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            global_pending_ = global_last_;
+        }
+        queued_.notify_one();
+    }
+
+    bool PlanPublisher::samePlan(const std::vector<geometry_msgs::PoseStamped>& path) const
+    {
+        if(!global_last_ || global_last_->poses.size() != path.size())
+        {
+            return false;
+        }
+
+        // stamps change with every transform of the plan, only the geometry matters
+        for(unsigned int i = 0; i < path.size(); ++i)
+        {
+            const auto& a = global_last_->poses[i];
+            const auto& b = path[i];
+            if(a.pose.position.x != b.pose.position.x || a.pose.position.y != b.pose.position.y ||
+                a.pose.position.z != b.pose.position.z || a.pose.orientation.x != b.pose.orientation.x ||
+                a.pose.orientation.y != b.pose.orientation.y || a.pose.orientation.z != b.pose.orientation.z ||
+                a.pose.orientation.w != b.pose.orientation.w || a.header.frame_id != b.header.frame_id)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void PlanPublisher::publishThread()
+    {
+        try
+        {
+            while(true)
+            {
+                bool publish_local;
+                boost::shared_ptr<const nav_msgs::Path> global_plan;
+                {
+                    boost::mutex::scoped_lock lock(mutex_);
+                    while(!local_queued_ && !global_pending_)
+                    {
+                        queued_.wait(lock);
+                    }
+                    publish_local = local_queued_;
+                    if(publish_local)
+                    {
+                        std::swap(local_pending_, local_current_);
+                        local_queued_ = false;
+                    }
+                    global_plan.swap(global_pending_);
+                }
+
+                // serialization happens here, out of the control loop
+                if(publish_local)
+                {
+                    local_pub_.publish(local_current_);
+                }
+                if(global_plan)
+                {
+                    global_pub_.publish(global_plan);
+                }
+            }
+        }
+        catch(const boost::thread_interrupted&)
+        {
+            ROS_DEBUG_NAMED("plan_publisher", "stopped publishing plans");
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define PREDICT_SERVICE_NAME "/human_pose_prediction/predict_human_poses"
+#define MESSAGE_THROTTLE_PERIOD 4.0 // seconds
+
+#include <hanp_local_planner/service_prediction_source.h>
+
+#include <pluginlib/class_list_macros.h>
+
+PLUGINLIB_EXPORT_CLASS(hanp_local_planner::ServicePredictionSource, hanp_local_planner::PredictionSource)
+
+namespace hanp_local_planner
+{
+    void ServicePredictionSource::initialize(std::string name)
+    {
+        ros::NodeHandle private_nh("~/" + name);
+        private_nh.param<std::string>("predict_service", predict_service_name_, PREDICT_SERVICE_NAME);
+        predict_humans_client_ = private_nh.serviceClient<hanp_prediction::HumanPosePredict>(predict_service_name_);
+
+        ROS_INFO_NAMED("service_prediction_source", "getting human predictions from %s service",
+            predict_service_name_.c_str());
+    }
+
+    bool ServicePredictionSource::predict(const std::vector<double>& predict_times,
+        std::vector<hanp_prediction::PredictedPoses>& predicted_humans)
+    {
+        predict_srv_.request.predict_times = predict_times;
+        predict_srv_.request.type = hanp_prediction::HumanPosePredictRequest::VELOCITY_OBSTACLE;
+
+        if(!predict_humans_client_.call(predict_srv_))
+        {
+            ROS_DEBUG_THROTTLE_NAMED(MESSAGE_THROTTLE_PERIOD, "service_prediction_source",
+                "failed to call %s service, is prediction server running?", predict_service_name_.c_str());
+            return false;
+        }
+
+        predicted_humans.swap(predict_srv_.response.predicted_humans_poses);
+        return true;
+    }
+}
@@ -0,0 +1,172 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/trajectory_cloud_publisher.h>
+
+#include <algorithm>
+
+#include <pcl_conversions/pcl_conversions.h>
+
+#define MAX_RATE 5.0 // Hz, default maximum rate of published clouds
+
+namespace hanp_local_planner
+{
+    TrajectoryCloudPublisher::TrajectoryCloudPublisher() : publish_thread_(NULL), trajectory_decimation_(1),
+        point_decimation_(1), min_period_(1.0 / MAX_RATE)
+    {
+        for(auto& cloud : clouds_)
+        {
+            free_.push_back(&cloud);
+        }
+    }
+
+    TrajectoryCloudPublisher::~TrajectoryCloudPublisher()
+    {
+        if(publish_thread_)
+        {
+            publish_thread_->interrupt();
+            publish_thread_->join();
+            delete publish_thread_;
+        }
+    }
+
+    void TrajectoryCloudPublisher::initialize(ros::NodeHandle& nh, const std::string& frame_id)
+    {
+        frame_id_ = frame_id;
+        publisher_.advertise(nh, "trajectory_cloud", 1);
+
+        if(!publish_thread_)
+        {
+            publish_thread_ = new boost::thread(boost::bind(&TrajectoryCloudPublisher::publishThread, this));
+        }
+    }
+
+    void TrajectoryCloudPublisher::setParams(int trajectory_decimation, int point_decimation, double max_rate)
+    {
+        trajectory_decimation_ = std::max(1, trajectory_decimation);
+        point_decimation_ = std::max(1, point_decimation);
+        min_period_ = max_rate > 0.0 ? 1.0 / max_rate : 1.0 / MAX_RATE;
+    }
+
+    bool TrajectoryCloudPublisher::ready() const
+    {
+        return publish_thread_ && publisher_.getNumSubscribers() > 0 &&
+            (ros::WallTime::now() - last_publish_).toSec() >= min_period_.load();
+    }
+
+    void TrajectoryCloudPublisher::publish(const std::vector<base_local_planner::Trajectory>& trajectories)
+    {
+        Cloud* cloud = NULL;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            if(!free_.empty())
+            {
+                cloud = free_.back();
+                free_.pop_back();
+            }
+            else if(!queue_.empty())
+            {
+                // latest trajectories win over those not published yet
+                cloud = queue_.front();
+                queue_.erase(queue_.begin());
+            }
+        }
+        if(!cloud)
+        {
+            return;
+        }
+        last_publish_ = ros::WallTime::now();
+
+        // points keep their capacity, so that steady state needs no allocation
+        cloud->points.clear();
+        std_msgs::Header header;
+        header.stamp = ros::Time::now();
+        header.frame_id = frame_id_;
+        cloud->header = pcl_conversions::toPCL(header);
+
+        unsigned int trajectory_decimation = trajectory_decimation_.load();
+        unsigned int point_decimation = point_decimation_.load();
+        unsigned int n_valid = 0;
+        base_local_planner::MapGridCostPoint pt;
+        pt.z = 0.0;
+        for(const auto& traj : trajectories)
+        {
+            if(traj.cost_ < 0 || n_valid++ % trajectory_decimation != 0)
+            {
+                continue;
+            }
+            pt.total_cost = traj.cost_;
+            for(unsigned int i = 0; i < traj.getPointsSize(); i += point_decimation)
+            {
+                double p_x, p_y, p_th;
+                traj.getPoint(i, p_x, p_y, p_th);
+                pt.x = p_x;
+                pt.y = p_y;
+                pt.path_cost = p_th;
+                cloud->points.push_back(pt);
+            }
+        }
+        cloud->width = cloud->points.size();
+        cloud->height = 1;
+
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            queue_.push_back(cloud);
+        }
+        queued_.notify_one();
+    }
+
+    void TrajectoryCloudPublisher::publishThread()
+    {
+        try
+        {
+            while(true)
+            {
+                Cloud* cloud;
+                {
+                    boost::mutex::scoped_lock lock(mutex_);
+                    while(queue_.empty())
+                    {
+                        queued_.wait(lock);
+                    }
+                    cloud = queue_.front();
+                    queue_.erase(queue_.begin());
+                }
+
+                // serialization happens here, off the control thread
+                publisher_.publish(*cloud);
+
+                boost::mutex::scoped_lock lock(mutex_);
+                free_.push_back(cloud);
+            }
+        }
+        catch(const boost::thread_interrupted&)
+        {
+            ROS_DEBUG_NAMED("trajectory_cloud_publisher", "stopped publishing trajectory clouds");
+        }
+    }
+}
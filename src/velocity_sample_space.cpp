@@ -0,0 +1,137 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/velocity_sample_space.h>
+
+#include <cmath>
+#include <algorithm>
+#include <base_local_planner/velocity_iterator.h>
+
+namespace hanp_local_planner
+{
+    VelocitySampleSpace::VelocitySampleSpace() : sim_time_(0.0), sim_period_(0.0), use_dwa_(false),
+        pos_(Eigen::Vector3f::Zero()), vel_(Eigen::Vector3f::Zero()), min_vel_(Eigen::Vector3f::Zero()),
+        max_vel_(Eigen::Vector3f::Zero()) {}
+
+    void VelocitySampleSpace::setParameters(double sim_time, double sim_period, bool use_dwa)
+    {
+        sim_time_ = sim_time;
+        sim_period_ = sim_period;
+        use_dwa_ = use_dwa;
+    }
+
+    void VelocitySampleSpace::initialise(const Eigen::Vector3f& pos, const Eigen::Vector3f& vel,
+        const Eigen::Vector3f& goal, const base_local_planner::LocalPlannerLimits& limits,
+        const Eigen::Vector3f& vsamples)
+    {
+        pos_ = pos;
+        vel_ = vel;
+        samples_.clear();
+
+        if(vsamples[0] * vsamples[1] * vsamples[2] <= 0)
+        {
+            return;
+        }
+
+        double max_vel_th = limits.max_rot_vel;
+        double min_vel_th = -1.0 * max_vel_th;
+        double min_vel_x = limits.min_vel_x;
+        double max_vel_x = limits.max_vel_x;
+        double min_vel_y = limits.min_vel_y;
+        double max_vel_y = limits.max_vel_y;
+        Eigen::Vector3f acc_lim = limits.getAccLimits();
+
+        // feasible velocity space, based on the rate at which we run
+        Eigen::Vector3f max_vel = Eigen::Vector3f::Zero();
+        Eigen::Vector3f min_vel = Eigen::Vector3f::Zero();
+        if(!use_dwa_)
+        {
+            // do not overshoot the goal in sim_time
+            double dist = hypot(goal[0] - pos[0], goal[1] - pos[1]);
+            max_vel_x = std::max(std::min(max_vel_x, dist / sim_time_), min_vel_x);
+            max_vel_y = std::max(std::min(max_vel_y, dist / sim_time_), min_vel_y);
+
+            max_vel[0] = std::min(max_vel_x, vel[0] + acc_lim[0] * sim_time_);
+            max_vel[1] = std::min(max_vel_y, vel[1] + acc_lim[1] * sim_time_);
+            max_vel[2] = std::min(max_vel_th, vel[2] + acc_lim[2] * sim_time_);
+
+            min_vel[0] = std::max(min_vel_x, vel[0] - acc_lim[0] * sim_time_);
+            min_vel[1] = std::max(min_vel_y, vel[1] - acc_lim[1] * sim_time_);
+            min_vel[2] = std::max(min_vel_th, vel[2] - acc_lim[2] * sim_time_);
+        }
+        else
+        {
+            // with dwa, only sample velocities reachable in sim_period
+            max_vel[0] = std::min(max_vel_x, vel[0] + acc_lim[0] * sim_period_);
+            max_vel[1] = std::min(max_vel_y, vel[1] + acc_lim[1] * sim_period_);
+            max_vel[2] = std::min(max_vel_th, vel[2] + acc_lim[2] * sim_period_);
+
+            min_vel[0] = std::max(min_vel_x, vel[0] - acc_lim[0] * sim_period_);
+            min_vel[1] = std::max(min_vel_y, vel[1] - acc_lim[1] * sim_period_);
+            min_vel[2] = std::max(min_vel_th, vel[2] - acc_lim[2] * sim_period_);
+        }
+
+        min_vel_ = min_vel;
+        max_vel_ = max_vel;
+
+        Eigen::Vector3f vel_samp = Eigen::Vector3f::Zero();
+        base_local_planner::VelocityIterator x_it(min_vel[0], max_vel[0], vsamples[0]);
+        base_local_planner::VelocityIterator y_it(min_vel[1], max_vel[1], vsamples[1]);
+        base_local_planner::VelocityIterator th_it(min_vel[2], max_vel[2], vsamples[2]);
+        for(; !x_it.isFinished(); x_it++)
+        {
+            vel_samp[0] = x_it.getVelocity();
+            for(; !y_it.isFinished(); y_it++)
+            {
+                vel_samp[1] = y_it.getVelocity();
+                for(; !th_it.isFinished(); th_it++)
+                {
+                    vel_samp[2] = th_it.getVelocity();
+                    samples_.push_back(vel_samp);
+                }
+                th_it.reset();
+            }
+            y_it.reset();
+        }
+    }
+
+    unsigned int VelocitySampleSpace::nearestSample(const Eigen::Vector3f& vel) const
+    {
+        unsigned int nearest = samples_.size();
+        float nearest_dist = 0.0;
+        for(unsigned int i = 0; i < samples_.size(); ++i)
+        {
+            float dist = (samples_[i] - vel).squaredNorm();
+            if(nearest == samples_.size() || dist < nearest_dist)
+            {
+                nearest = i;
+                nearest_dist = dist;
+            }
+        }
+        return nearest;
+    }
+}
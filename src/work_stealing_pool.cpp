@@ -0,0 +1,181 @@
+/*/
+ * Copyright (c) 2015 LAAS/CNRS
+ * All rights reserved.
+ *
+ * Redistribution and use  in source  and binary  forms,  with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *   1. Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <hanp_local_planner/work_stealing_pool.h>
+
+#include <algorithm>
+
+namespace hanp_local_planner
+{
+    WorkStealingPool::WorkStealingPool() : task_(NULL), job_id_(0), busy_workers_(0), stop_(false)
+    {
+        resize(1);
+    }
+
+    WorkStealingPool::~WorkStealingPool()
+    {
+        stopThreads();
+    }
+
+    void WorkStealingPool::resize(unsigned int workers)
+    {
+        stopThreads();
+
+        workers = std::max(1u, workers);
+        queues_.clear();
+        for(unsigned int i = 0; i < workers; ++i)
+        {
+            queues_.push_back(boost::shared_ptr<RangeQueue>(new RangeQueue()));
+        }
+
+        // calling thread is worker 0
+        stop_ = false;
+        for(unsigned int i = 1; i < workers; ++i)
+        {
+            threads_.create_thread(boost::bind(&WorkStealingPool::workerThread, this, i));
+        }
+    }
+
+    void WorkStealingPool::stopThreads()
+    {
+        {
+            boost::mutex::scoped_lock lock(job_mutex_);
+            stop_ = true;
+        }
+        job_cond_.notify_all();
+        threads_.join_all();
+    }
+
+    void WorkStealingPool::parallelFor(unsigned int count, unsigned int grain, const RangeTask& task)
+    {
+        if(count == 0)
+        {
+            return;
+        }
+        grain = std::max(1u, grain);
+
+        // deal contiguous blocks of ranges to the workers
+        unsigned int workers = size();
+        unsigned int n_ranges = (count + grain - 1) / grain;
+        for(unsigned int r = 0; r < n_ranges; ++r)
+        {
+            Range range;
+            range.begin = r * grain;
+            range.end = std::min(count, range.begin + grain);
+            auto& queue = *queues_[(unsigned long)r * workers / n_ranges];
+            boost::mutex::scoped_lock lock(queue.mutex);
+            queue.ranges.push_back(range);
+        }
+
+        {
+            boost::mutex::scoped_lock lock(job_mutex_);
+            task_ = &task;
+            busy_workers_ = workers - 1;
+            ++job_id_;
+        }
+        job_cond_.notify_all();
+
+        runRanges(0);
+
+        // task must stay alive until every worker has left it
+        {
+            boost::mutex::scoped_lock lock(job_mutex_);
+            while(busy_workers_ > 0)
+            {
+                done_cond_.wait(lock);
+            }
+            task_ = NULL;
+        }
+    }
+
+    void WorkStealingPool::workerThread(unsigned int worker)
+    {
+        unsigned long last_job_id = 0;
+        while(true)
+        {
+            {
+                boost::mutex::scoped_lock lock(job_mutex_);
+                while(!stop_ && job_id_ == last_job_id)
+                {
+                    job_cond_.wait(lock);
+                }
+                if(stop_)
+                {
+                    return;
+                }
+                last_job_id = job_id_;
+            }
+
+            runRanges(worker);
+
+            {
+                boost::mutex::scoped_lock lock(job_mutex_);
+                --busy_workers_;
+            }
+            done_cond_.notify_one();
+        }
+    }
+
+    void WorkStealingPool::runRanges(unsigned int worker)
+    {
+        const RangeTask& task = *task_;
+        Range range;
+        while(popRange(worker, range) || stealRange(worker, range))
+        {
+            task(worker, range.begin, range.end);
+        }
+    }
+
+    bool WorkStealingPool::popRange(unsigned int worker, Range& range)
+    {
+        auto& queue = *queues_[worker];
+        boost::mutex::scoped_lock lock(queue.mutex);
+        if(queue.ranges.empty())
+        {
+            return false;
+        }
+        range = queue.ranges.front();
+        queue.ranges.pop_front();
+        return true;
+    }
+
+    bool WorkStealingPool::stealRange(unsigned int worker, Range& range)
+    {
+        for(unsigned int i = 1; i < size(); ++i)
+        {
+            auto& queue = *queues_[(worker + i) % size()];
+            boost::mutex::scoped_lock lock(queue.mutex);
+            if(!queue.ranges.empty())
+            {
+                range = queue.ranges.back();
+                queue.ranges.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+}